@@ -1,332 +1,771 @@
 #include <iostream>
 #include <vector>
-
-template <typename T>
+#include <algorithm>
+#include <numeric>
+#include <functional>
+#include <utility>
+#include <stdexcept>
+#include <exception>
+#include <new>
+#include <iterator>
+#include <type_traits>
+#include <cstddef>
+#include <memory>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <chrono>
+
+template <typename T, size_t ChunkBytes>
+class SpscDeque;
+
+template <typename T, size_t ChunkBytes>
+class WorkStealingDeque;
+
+template <typename T, size_t ChunkBytes = 4096, typename Allocator = std::allocator<T>>
 class Deque {
 private:
-    static const size_t chunk_capacity = 32;
+    template <typename U, size_t Bytes> friend class SpscDeque;
+    template <typename U, size_t Bytes> friend class WorkStealingDeque;
+
+    static constexpr size_t chunk_capacity_for(size_t budget) {
+        size_t capacity = 1;
+        while (2 * capacity * sizeof(T) <= budget)
+            capacity *= 2;
+        return capacity;
+    }
+
+    static constexpr size_t log2(size_t value) {
+        size_t result = 0;
+        while (value > 1) {
+            value /= 2;
+            ++result;
+        }
+        return result;
+    }
+
+    // Elements per chunk: the largest power of two that fits into ChunkBytes (at least one).
+    static constexpr size_t chunk_capacity = chunk_capacity_for(ChunkBytes);
+    static constexpr size_t chunk_shift = log2(chunk_capacity);
+    static constexpr size_t chunk_mask = chunk_capacity - 1;
+    static constexpr size_t huge_page_size = size_t(1) << 21;
+    static constexpr size_t chunk_alignment = (chunk_capacity * sizeof(T) >= huge_page_size ? huge_page_size : std::max<size_t>(64, alignof(T)));
+    static const size_t spare_chunks_limit = 2;
+
+    struct alignas(chunk_alignment) chunk_storage {
+        unsigned char bytes[chunk_capacity * sizeof(T)];
+    };
+
+    using AllocatorTraits = std::allocator_traits<Allocator>;
+    using ChunkAllocator = typename AllocatorTraits::template rebind_alloc<chunk_storage>;
+    using MapAllocator = typename AllocatorTraits::template rebind_alloc<T*>;
+    using Map = std::vector<T*, MapAllocator>;
+
+    Allocator allocator;
+    ChunkAllocator chunk_allocator{allocator};
     size_t deque_size = 0;
-    std::vector<T*> array;
-    std::pair<size_t, size_t> first_element_location;
-    std::pair<size_t, size_t> last_element_location;
+    // Chunk map; only slots between the first and the last element hold chunks, the rest are nullptr.
+    Map array{MapAllocator(allocator)};
+    std::pair<size_t, size_t> first_element_location{1, 0};
+    std::pair<size_t, size_t> last_element_location{0, chunk_mask};
+    T* spare_chunks[spare_chunks_limit] = {};
+    size_t spare_chunks_count = 0;
+
+    T* allocate_chunk();
+    void deallocate_chunk(T* chunk);
+    template <bool SwapAllocators>
+    void swap_storage(Deque& other_deque);
+    void reset_locations();
+    T* acquire_chunk();
+    void release_chunk(T*& chunk);
+    void reallocate_map(bool at_front, size_t extra_chunks = 1);
+    void reserve_map(bool at_front, size_t count);
+
+    T* element_pointer(size_t index) const;
+    size_t chunk_offset(size_t index) const;
+    void move_elements(size_t from, size_t to, size_t count);
+    void move_elements_backward(size_t from, size_t to, size_t count);
+    template <typename InputIterator>
+    void prepend(InputIterator first, size_t count);
+    template <typename Iterator>
+    static Iterator find_in_segments(Iterator first, Iterator last, const T& value);
+
+    template <typename Iterator>
+    static auto move_if_noexcept_iterator(Iterator iter) {
+        if constexpr (std::is_nothrow_move_constructible_v<T> || !std::is_copy_constructible_v<T>)
+            return std::make_move_iterator(iter);
+        else
+            return iter;
+    }
 
 public:
 
+    using allocator_type = Allocator;
+
     Deque();
-    explicit Deque(const int& given_size, const T& value = T());
+    explicit Deque(const Allocator& given_allocator);
+    explicit Deque(const int& given_size, const T& value = T(), const Allocator& given_allocator = Allocator());
     Deque(const Deque& other_deque);
+    Deque(const Deque& other_deque, const Allocator& given_allocator);
+    Deque(Deque&& other_deque) noexcept;
+    ~Deque();
+
+    Allocator get_allocator() const;
 
     size_t size() const;
+    size_t capacity_bytes() const;
+    bool empty() const;
+    void clear();
     void swap(Deque& other_deque);
+    void shrink_to_fit();
 
     Deque& operator=(const Deque& other_deque);
+    Deque& operator=(Deque&& other_deque) noexcept(AllocatorTraits::propagate_on_container_move_assignment::value
+                                                   || AllocatorTraits::is_always_equal::value);
     T& operator[](size_t index);
     const T& operator[](size_t index) const;
     T& at(size_t index);
     const T& at(size_t index) const;
     void push_back(const T& value);
+    void push_back(T&& value);
     void pop_back();
     void push_front(const T& value);
+    void push_front(T&& value);
     void pop_front();
 
+    template <typename... Args>
+    T& emplace_back(Args&&... args);
+    template <typename... Args>
+    T& emplace_front(Args&&... args);
+
+    // Caches the bounds of the current chunk like libstdc++, so stepping within a chunk is a pointer
+    // increment and equality is a single pointer comparison.
     template <bool is_const>
     struct deque_iterator {
-        size_t element_index;
-        typename std::vector<T*>::const_iterator pointer;
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = std::conditional_t<is_const, const T*, T*>;
+        using reference = std::conditional_t<is_const, const T&, T&>;
+
+        T* current = nullptr;
+        T* chunk_begin = nullptr;
+        T* chunk_end = nullptr;
+        T* const* node = nullptr;
+
+        deque_iterator() = default;
+
+        deque_iterator(T* const* chunk_node, size_t element_index) {
+            set_node(chunk_node);
+            current = (chunk_begin == nullptr ? nullptr : chunk_begin + element_index);
+        }
 
-        deque_iterator(typename std::vector<T*>::const_iterator pointer, size_t element_index): element_index(element_index), pointer(pointer) {}
+        template <bool other_const, typename = std::enable_if_t<is_const && !other_const>>
+        deque_iterator(const deque_iterator<other_const>& other): current(other.current), chunk_begin(other.chunk_begin),
+                chunk_end(other.chunk_end), node(other.node) {}
 
-        deque_iterator& operator++() {
-            if (element_index == chunk_capacity - 1)
-                ++pointer;
+        void set_node(T* const* new_node) {
+            node = new_node;
+            chunk_begin = *new_node;
+            chunk_end = (chunk_begin == nullptr ? nullptr : chunk_begin + chunk_capacity);
+        }
 
-            ++element_index;
-            element_index %= chunk_capacity;
+        reference operator*() const {
+            return *current;
+        }
+
+        pointer operator->() const {
+            return current;
+        }
 
+        reference operator[](difference_type shift) const {
+            return *(*this + shift);
+        }
+
+        deque_iterator& operator++() {
+            ++current;
+            if (current == chunk_end) {
+                set_node(node + 1);
+                current = chunk_begin;
+            }
             return *this;
         }
 
-        deque_iterator& operator--() {
-            if (element_index == 0)
-                --pointer;
-            element_index = (chunk_capacity + element_index - 1) % chunk_capacity;
+        deque_iterator operator++(int) {
+            deque_iterator result = *this;
+            ++*this;
+            return result;
+        }
 
+        deque_iterator& operator--() {
+            if (current == chunk_begin) {
+                set_node(node - 1);
+                current = chunk_end;
+            }
+            --current;
             return *this;
         }
 
-        int operator-(const deque_iterator<is_const>& other) const{
-            return (pointer - other.pointer) * chunk_capacity + static_cast<int>(element_index) - static_cast<int>(other.element_index);
+        deque_iterator operator--(int) {
+            deque_iterator result = *this;
+            --*this;
+            return result;
         }
 
-        deque_iterator<is_const> operator+(const int& shift) const {
-            return deque_iterator<is_const>(pointer + (element_index + shift) / chunk_capacity, (element_index + shift) % chunk_capacity);
+        deque_iterator& operator+=(difference_type shift) {
+            const difference_type capacity = static_cast<difference_type>(chunk_capacity);
+            difference_type offset = shift + (current - chunk_begin);
+            if (offset >= 0 && offset < capacity) {
+                current += shift;
+            } else {
+                difference_type node_shift = (offset > 0 ? offset / capacity : -((-offset - 1) / capacity) - 1);
+                set_node(node + node_shift);
+                current = (chunk_begin == nullptr ? nullptr : chunk_begin + (offset - node_shift * capacity));
+            }
+            return *this;
         }
 
-        deque_iterator<is_const> operator-(const int& shift) const {
-            int blocks_difference = (element_index - shift) / chunk_capacity;
-            blocks_difference = blocks_difference - ((element_index - shift) % chunk_capacity < 0 ? 1 : 0);
+        deque_iterator& operator-=(difference_type shift) {
+            return *this += -shift;
+        }
 
-            return deque_iterator<is_const>(pointer + blocks_difference, ((element_index - shift) % chunk_capacity + chunk_capacity) % chunk_capacity);
+        deque_iterator operator+(difference_type shift) const {
+            deque_iterator result = *this;
+            return result += shift;
         }
 
-        bool operator<(const deque_iterator<is_const>& other) const {
-            if (*this - other < 0)
-                return true;
-            return false;
+        deque_iterator operator-(difference_type shift) const {
+            deque_iterator result = *this;
+            return result -= shift;
         }
 
-        bool operator>(const deque_iterator<is_const>& other) const {
-            if (*this - other > 0)
-                return true;
-            return false;
+        friend deque_iterator operator+(difference_type shift, const deque_iterator& iter) {
+            return iter + shift;
         }
 
-        bool operator==(const deque_iterator<is_const>& other) const {
-            if (!(*this < other) && !(*this > other))
-                return true;
-            return false;
+        friend difference_type operator-(const deque_iterator& first, const deque_iterator& second) {
+            return static_cast<difference_type>(chunk_capacity) * (first.node - second.node)
+                   + (first.current - first.chunk_begin) - (second.current - second.chunk_begin);
         }
 
-        bool operator!=(const deque_iterator<is_const>& other) const {
-            if (!(*this == other))
-                return true;
-            return false;
+        friend bool operator==(const deque_iterator& first, const deque_iterator& second) {
+            return first.current == second.current;
         }
 
-        bool operator<=(const deque_iterator<is_const>& other) const {
-            if (*this < other || *this == other)
-                return true;
-            return false;
+        friend bool operator!=(const deque_iterator& first, const deque_iterator& second) {
+            return first.current != second.current;
         }
 
-        bool operator>=(const deque_iterator<is_const>& other) const {
-            if (*this > other || *this == other)
-                return true;
-            return false;
+        friend bool operator<(const deque_iterator& first, const deque_iterator& second) {
+            return first.node == second.node ? first.current < second.current : first.node < second.node;
         }
 
-        std::conditional_t<is_const, const T&, T&> operator*() const {
-            auto& needed = *(*pointer + element_index);
-            return needed;
+        friend bool operator>(const deque_iterator& first, const deque_iterator& second) {
+            return second < first;
         }
 
-        std::conditional_t<is_const, const T*, T*> operator->() const {
-            auto needed = ((*pointer) + element_index);
-            return needed;
+        friend bool operator<=(const deque_iterator& first, const deque_iterator& second) {
+            return !(second < first);
         }
 
+        friend bool operator>=(const deque_iterator& first, const deque_iterator& second) {
+            return !(first < second);
+        }
     };
 
     using iterator = deque_iterator<false>;
-    using const_iterator = const deque_iterator<true>;
+    using const_iterator = deque_iterator<true>;
+    using reverse_iterator = std::reverse_iterator<iterator>;
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
 
     iterator begin() {
-        auto needed = iterator(array.begin() + first_element_location.first, first_element_location.second);
-        return needed;
+        if (array.empty())
+            return iterator();
+        return iterator(array.data() + first_element_location.first, first_element_location.second);
     }
 
     iterator end() {
-        Deque::deque_iterator<false> iterator_copy = iterator(array.begin() + last_element_location.first, last_element_location.second) + 1;
-        return iterator_copy;
+        if (array.empty())
+            return iterator();
+        size_t offset = last_element_location.second + 1;
+        return iterator(array.data() + last_element_location.first + (offset >> chunk_shift), offset & chunk_mask);
     }
 
     const_iterator begin() const {
-        auto needed = const_iterator(array.begin() + first_element_location.first, first_element_location.second);
-        return needed;
+        if (array.empty())
+            return const_iterator();
+        return const_iterator(array.data() + first_element_location.first, first_element_location.second);
     }
 
     const_iterator end() const {
-        Deque::deque_iterator<true> iterator_copy = const_iterator(array.begin() + last_element_location.first, last_element_location.second) + 1;
-        return iterator_copy;
+        if (array.empty())
+            return const_iterator();
+        size_t offset = last_element_location.second + 1;
+        return const_iterator(array.data() + last_element_location.first + (offset >> chunk_shift), offset & chunk_mask);
     }
 
     const_iterator cbegin() const {
-        auto needed = const_iterator(array.begin() + first_element_location.first, first_element_location.second);
-        return needed;
+        return begin();
     }
 
     const_iterator cend() const {
-        Deque::deque_iterator<true> iterator_copy = const_iterator(array.begin() + last_element_location.first, last_element_location.second) + 1;
-        return iterator_copy;
+        return end();
     }
 
+    reverse_iterator rbegin() { return reverse_iterator(end()); }
+    reverse_iterator rend() { return reverse_iterator(begin()); }
+    const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+    const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+    const_reverse_iterator crbegin() const { return const_reverse_iterator(end()); }
+    const_reverse_iterator crend() const { return const_reverse_iterator(begin()); }
+
+    // Calls function(first, last) for every contiguous run of elements, one chunk at a time,
+    // so the loop inside each call works on plain pointers and can be vectorized.
+    template <typename Function>
+    void for_each_segment(Function function);
+    template <typename Function>
+    void for_each_segment(Function function) const;
+
+    // Per-segment overloads of common algorithms. They are hidden friends, so they are found only
+    // by argument-dependent lookup on a Deque and never compete with the std:: versions.
+    template <typename OutputIterator>
+    friend OutputIterator copy(const Deque& deque, OutputIterator result) {
+        deque.for_each_segment([&result](const T* first, const T* last) {
+            result = std::copy(first, last, result);
+        });
+        return result;
+    }
 
-//    using reverse_iterator = std::reverse_iterator<iterator>;
-//    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+    friend void fill(Deque& deque, const T& value) {
+        deque.for_each_segment([&value](T* first, T* last) {
+            std::fill(first, last, value);
+        });
+    }
+
+    friend iterator find(Deque& deque, const T& value) {
+        return find_in_segments(deque.begin(), deque.end(), value);
+    }
+
+    friend const_iterator find(const Deque& deque, const T& value) {
+        return find_in_segments(deque.begin(), deque.end(), value);
+    }
 
-//    reverse_iterator rbegin() { return std::reverse_iterator(end());}
-//    reverse_iterator rend() { return std::reverse_iterator(begin());}
-//    const_reverse_iterator rbegin() const { return std::reverse_iterator(cend());}
-//    const_reverse_iterator rend() const { return std::reverse_iterator(cbegin());}
-//    const_reverse_iterator crbegin() const { return std::reverse_iterator(cend());}
-//    const_reverse_iterator crend() const { return std::reverse_iterator(cbegin());}
+    template <typename Value, typename BinaryOperation>
+    friend Value accumulate(const Deque& deque, Value init, BinaryOperation operation) {
+        deque.for_each_segment([&init, &operation](const T* first, const T* last) {
+            init = std::accumulate(first, last, std::move(init), operation);
+        });
+        return init;
+    }
+
+    template <typename Value>
+    friend Value accumulate(const Deque& deque, Value init) {
+        return accumulate(deque, std::move(init), std::plus<>());
+    }
 
+    template <typename... Args>
+    void emplace(iterator needed_iterator, Args&&... args);
     void insert(iterator needed_iterator, const T& value);
+    void insert(iterator needed_iterator, T&& value);
+    template <typename ForwardIterator>
+    void insert(iterator needed_iterator, ForwardIterator first, ForwardIterator last);
     void erase(iterator needed_iterator);
+    void erase(iterator first, iterator last);
+
+    template <typename InputIterator>
+    void append(InputIterator first, InputIterator last);
+    template <typename InputIterator>
+    void assign(InputIterator first, InputIterator last);
+    void assign(size_t count, const T& value);
 };
 
-template<typename T>
-Deque<T>::Deque() {
-    array.resize(4);
-    first_element_location = std::make_pair(array.size()/2, chunk_capacity/2 + 1);
-    last_element_location = std::make_pair(array.size()/2, chunk_capacity/2);
+template<typename T, size_t ChunkBytes, typename Allocator>
+Deque<T, ChunkBytes, Allocator>::Deque() = default;
 
-    for (size_t i = 0; i < array.size(); ++i) {
-        array[i] = reinterpret_cast<T*>(new int8_t[chunk_capacity * sizeof(T)]);
-    }
+template<typename T, size_t ChunkBytes, typename Allocator>
+T* Deque<T, ChunkBytes, Allocator>::allocate_chunk() {
+    return reinterpret_cast<T*>(std::allocator_traits<ChunkAllocator>::allocate(chunk_allocator, 1));
+}
+
+template<typename T, size_t ChunkBytes, typename Allocator>
+void Deque<T, ChunkBytes, Allocator>::deallocate_chunk(T* chunk) {
+    if (chunk != nullptr)
+        std::allocator_traits<ChunkAllocator>::deallocate(chunk_allocator, reinterpret_cast<chunk_storage*>(chunk), 1);
+}
+
+template<typename T, size_t ChunkBytes, typename Allocator>
+void Deque<T, ChunkBytes, Allocator>::reset_locations() {
+    first_element_location = std::make_pair(1, 0);
+    last_element_location = std::make_pair(0, chunk_mask);
+}
+
+template<typename T, size_t ChunkBytes, typename Allocator>
+T* Deque<T, ChunkBytes, Allocator>::acquire_chunk() {
+    if (spare_chunks_count > 0)
+        return spare_chunks[--spare_chunks_count];
+    return allocate_chunk();
+}
+
+template<typename T, size_t ChunkBytes, typename Allocator>
+void Deque<T, ChunkBytes, Allocator>::release_chunk(T*& chunk) {
+    if (chunk == nullptr)
+        return;
+    if (spare_chunks_count < spare_chunks_limit)
+        spare_chunks[spare_chunks_count++] = chunk;
+    else
+        deallocate_chunk(chunk);
+    chunk = nullptr;
 }
 
-template<typename T>
-Deque<T>::Deque(const int& given_size, const T& value) {
-    size_t new_array_size = static_cast<size_t>(static_cast<double>(given_size) / static_cast<double>(chunk_capacity)) + 1;
-    array.resize(new_array_size);
-    deque_size = given_size;
-    first_element_location.first = 0;
-    first_element_location.second = 0;
-    last_element_location.first = new_array_size - 1;
-    last_element_location.second = (given_size - 1) % chunk_capacity;
+// Makes room for extra_chunks more chunk slots at the requested end and keeps a spare slot past the
+// last chunk, so that end() always refers to a valid map entry. If the map is at most half full the
+// occupied slots are recentered in place, otherwise a larger map is built around them; either way
+// only chunk pointers move and chunks themselves are allocated lazily on first use.
+template<typename T, size_t ChunkBytes, typename Allocator>
+void Deque<T, ChunkBytes, Allocator>::reallocate_map(bool at_front, size_t extra_chunks) {
+    if (array.empty()) {
+        array.assign(8, nullptr);
+        first_element_location = std::make_pair(array.size()/2, chunk_capacity/2);
+        if (chunk_capacity == 1)
+            last_element_location = std::make_pair(array.size()/2 - 1, 0);
+        else
+            last_element_location = std::make_pair(array.size()/2, chunk_capacity/2 - 1);
+        return;
+    }
 
-    for (size_t i = 0; i < new_array_size; ++i) {
-        array[i] = reinterpret_cast<T*>(new int8_t[chunk_capacity * sizeof(T)]);
-        for (size_t j = 0; j < chunk_capacity; ++j) {
-            if (i == new_array_size - 1 && j > last_element_location.second)
-                break;
-            new (array[i] + j) T(value);
+    size_t old_start = first_element_location.first;
+    size_t used_chunks = last_element_location.first + 1 - old_start;
+    size_t new_used_chunks = used_chunks + extra_chunks + 1;
+    size_t new_start = 0;
+
+    if (array.size() > 2 * new_used_chunks) {
+        new_start = (array.size() - new_used_chunks) / 2 + (at_front ? extra_chunks : 0);
+        if (new_start < old_start) {
+            std::copy(array.begin() + old_start, array.begin() + old_start + used_chunks, array.begin() + new_start);
+            std::fill(array.begin() + std::max(new_start + used_chunks, old_start), array.begin() + old_start + used_chunks, nullptr);
+        } else {
+            std::copy_backward(array.begin() + old_start, array.begin() + old_start + used_chunks, array.begin() + new_start + used_chunks);
+            std::fill(array.begin() + old_start, array.begin() + std::min(new_start, old_start + used_chunks), nullptr);
         }
+    } else {
+        Map new_array(array.size() + std::max(array.size(), new_used_chunks) + 2, nullptr, array.get_allocator());
+        new_start = (new_array.size() - new_used_chunks) / 2 + (at_front ? extra_chunks : 0);
+        std::copy(array.begin() + old_start, array.begin() + old_start + used_chunks, new_array.begin() + new_start);
+        array.swap(new_array);
     }
+
+    first_element_location.first += new_start - old_start;
+    last_element_location.first += new_start - old_start;
+}
+
+// Grows the map until count more elements fit at the requested end, so that constructing them
+// there never reallocates the map and iterators taken afterwards stay valid.
+template<typename T, size_t ChunkBytes, typename Allocator>
+void Deque<T, ChunkBytes, Allocator>::reserve_map(bool at_front, size_t count) {
+    auto extra_chunks = [this, at_front, count]() -> size_t {
+        if (at_front) {
+            size_t room = first_element_location.second;
+            return (count > room ? ((count - room - 1) >> chunk_shift) + 1 : 0);
+        }
+        return ((last_element_location.second + count) >> chunk_shift) + 1;
+    };
+    while (array.empty() || (at_front ? first_element_location.first < extra_chunks()
+                                      : last_element_location.first + extra_chunks() + 1 >= array.size()))
+        reallocate_map(at_front, extra_chunks());
 }
 
-template<typename T>
-Deque<T>::Deque(const Deque& other_deque): Deque() {
+template<typename T, size_t ChunkBytes, typename Allocator>
+Deque<T, ChunkBytes, Allocator>::Deque(const int& given_size, const T& value, const Allocator& given_allocator): Deque(given_allocator) {
+    // The delegating constructor has finished, so if a copy throws the destructor frees what was built.
+    for (int i = 0; i < given_size; ++i) {
+        emplace_back(value);
+    }
+}
+
+template<typename T, size_t ChunkBytes, typename Allocator>
+Deque<T, ChunkBytes, Allocator>::Deque(const Deque& other_deque):
+        Deque(other_deque, AllocatorTraits::select_on_container_copy_construction(other_deque.allocator)) {}
+
+template<typename T, size_t ChunkBytes, typename Allocator>
+Deque<T, ChunkBytes, Allocator>::Deque(const Deque& other_deque, const Allocator& given_allocator): Deque(given_allocator) {
+    other_deque.for_each_segment([this](const T* first, const T* last) {
+        for (; first != last; ++first) {
+            emplace_back(*first);
+        }
+    });
+}
+
+template<typename T, size_t ChunkBytes, typename Allocator>
+Deque<T, ChunkBytes, Allocator>::Deque(Deque&& other_deque) noexcept: allocator(std::move(other_deque.allocator)),
+        chunk_allocator(std::move(other_deque.chunk_allocator)), array(std::move(other_deque.array)) {
+    deque_size = other_deque.deque_size;
     first_element_location = other_deque.first_element_location;
     last_element_location = other_deque.last_element_location;
-    deque_size = other_deque.deque_size;
-    array.resize(other_deque.array.size());
 
-    for (size_t i = 0; i < array.size(); ++i) {
-        array[i] = reinterpret_cast<T*>(new int8_t[chunk_capacity*sizeof(T)]);
+    std::copy(other_deque.spare_chunks, other_deque.spare_chunks + spare_chunks_limit, spare_chunks);
+    spare_chunks_count = other_deque.spare_chunks_count;
 
-        if ((i <= last_element_location.first) && (i >= first_element_location.first)) {
-            for (size_t j = 0; j < chunk_capacity; ++j) {
-                new (array[i] + j) T(other_deque.array[i][j]);
-            }
+    other_deque.array.clear();
+    other_deque.spare_chunks_count = 0;
+    other_deque.deque_size = 0;
+    other_deque.reset_locations();
+}
+
+template<typename T, size_t ChunkBytes, typename Allocator>
+Deque<T, ChunkBytes, Allocator>::Deque(const Allocator& given_allocator): allocator(given_allocator),
+        chunk_allocator(given_allocator), array(MapAllocator(given_allocator)) {}
+
+template<typename T, size_t ChunkBytes, typename Allocator>
+Deque<T, ChunkBytes, Allocator>::~Deque() {
+    for_each_segment([this](T* first, T* last) {
+        for (; first != last; ++first) {
+            AllocatorTraits::destroy(allocator, first);
         }
+    });
+    for (auto& chunk : array) {
+        deallocate_chunk(chunk);
+    }
+    for (size_t i = 0; i < spare_chunks_count; ++i) {
+        deallocate_chunk(spare_chunks[i]);
     }
 }
 
-template<typename T>
-Deque<T>& Deque<T>::operator=(const Deque<T>& other_deque) {
-    Deque iterator_copy = Deque(other_deque);
-    swap(iterator_copy);
+template<typename T, size_t ChunkBytes, typename Allocator>
+Allocator Deque<T, ChunkBytes, Allocator>::get_allocator() const {
+    return allocator;
+}
+
+template<typename T, size_t ChunkBytes, typename Allocator>
+Deque<T, ChunkBytes, Allocator>& Deque<T, ChunkBytes, Allocator>::operator=(const Deque<T, ChunkBytes, Allocator>& other_deque) {
+    if (this == &other_deque)
+        return *this;
+    const Allocator& target_allocator = (AllocatorTraits::propagate_on_container_copy_assignment::value ? other_deque.allocator : allocator);
+    Deque iterator_copy(other_deque, target_allocator);
+    swap_storage<AllocatorTraits::propagate_on_container_copy_assignment::value>(iterator_copy);
     return *this;
 }
 
-template<typename T>
-size_t Deque<T>::size() const {
+template<typename T, size_t ChunkBytes, typename Allocator>
+Deque<T, ChunkBytes, Allocator>& Deque<T, ChunkBytes, Allocator>::operator=(Deque<T, ChunkBytes, Allocator>&& other_deque)
+        noexcept(AllocatorTraits::propagate_on_container_move_assignment::value || AllocatorTraits::is_always_equal::value) {
+    if (this == &other_deque)
+        return *this;
+    if (AllocatorTraits::propagate_on_container_move_assignment::value || allocator == other_deque.allocator) {
+        Deque moved_copy(std::move(other_deque));
+        swap_storage<AllocatorTraits::propagate_on_container_move_assignment::value>(moved_copy);
+    } else {
+        Deque moved_copy(allocator);
+        for (auto& element : other_deque) {
+            moved_copy.emplace_back(std::move(element));
+        }
+        swap_storage<AllocatorTraits::propagate_on_container_move_assignment::value>(moved_copy);
+    }
+    return *this;
+}
+
+template<typename T, size_t ChunkBytes, typename Allocator>
+size_t Deque<T, ChunkBytes, Allocator>::size() const {
     return deque_size;
 }
 
-template<typename T>
-void Deque<T>::swap(Deque& other_deque) {
+// Without SwapAllocators the two allocators must compare equal; allocators that are not
+// assignable (such as std::pmr::polymorphic_allocator) are then never touched.
+template<typename T, size_t ChunkBytes, typename Allocator>
+template<bool SwapAllocators>
+void Deque<T, ChunkBytes, Allocator>::swap_storage(Deque& other_deque) {
+    if constexpr (SwapAllocators) {
+        using std::swap;
+        swap(allocator, other_deque.allocator);
+        swap(chunk_allocator, other_deque.chunk_allocator);
+    }
     std::swap(array, other_deque.array);
     std::swap(deque_size, other_deque.deque_size);
     std::swap(first_element_location, other_deque.first_element_location);
     std::swap(last_element_location, other_deque.last_element_location);
+    std::swap(spare_chunks, other_deque.spare_chunks);
+    std::swap(spare_chunks_count, other_deque.spare_chunks_count);
+}
+
+template<typename T, size_t ChunkBytes, typename Allocator>
+void Deque<T, ChunkBytes, Allocator>::swap(Deque& other_deque) {
+    swap_storage<AllocatorTraits::propagate_on_container_swap::value>(other_deque);
+}
+
+// Map, chunks holding elements and cached spare chunks.
+template<typename T, size_t ChunkBytes, typename Allocator>
+size_t Deque<T, ChunkBytes, Allocator>::capacity_bytes() const {
+    size_t chunks = spare_chunks_count + static_cast<size_t>(std::count_if(array.begin(), array.end(), [](const T* chunk) {
+        return chunk != nullptr;
+    }));
+    return array.capacity() * sizeof(T*) + chunks * sizeof(chunk_storage);
+}
+
+template<typename T, size_t ChunkBytes, typename Allocator>
+void Deque<T, ChunkBytes, Allocator>::shrink_to_fit() {
+    for (size_t i = 0; i < spare_chunks_count; ++i) {
+        deallocate_chunk(spare_chunks[i]);
+    }
+    spare_chunks_count = 0;
+
+    if (deque_size == 0) {
+        for (auto& chunk : array) {
+            deallocate_chunk(chunk);
+        }
+        Map(array.get_allocator()).swap(array);
+        reset_locations();
+        return;
+    }
+
+    size_t used_begin = first_element_location.first;
+    size_t used_end = last_element_location.first + 1;
+    Map new_array(array.begin() + used_begin, array.begin() + used_end, array.get_allocator());
+    new_array.push_back(nullptr);
+    array.swap(new_array);
+    first_element_location.first -= used_begin;
+    last_element_location.first -= used_begin;
 }
 
-template<typename T>
-T& Deque<T>::operator[](size_t index) {
-    return array[first_element_location.first + (first_element_location.second + index) / chunk_capacity][(first_element_location.second + index) % chunk_capacity];
+template<typename T, size_t ChunkBytes, typename Allocator>
+T& Deque<T, ChunkBytes, Allocator>::operator[](size_t index) {
+    size_t offset = first_element_location.second + index;
+    return array[first_element_location.first + (offset >> chunk_shift)][offset & chunk_mask];
 }
 
-template<typename T>
-const T& Deque<T>::operator[](size_t index) const {
-    return array[first_element_location.first + (first_element_location.second + index) / chunk_capacity][(first_element_location.second + index) % chunk_capacity];
+template<typename T, size_t ChunkBytes, typename Allocator>
+const T& Deque<T, ChunkBytes, Allocator>::operator[](size_t index) const {
+    size_t offset = first_element_location.second + index;
+    return array[first_element_location.first + (offset >> chunk_shift)][offset & chunk_mask];
 }
 
-template<typename T>
-T& Deque<T>::at(size_t index) {
+template<typename T, size_t ChunkBytes, typename Allocator>
+T& Deque<T, ChunkBytes, Allocator>::at(size_t index) {
     if (index >= deque_size)
         throw std::out_of_range("Error: out of range");
     return (*this)[index];
 }
 
-template<typename T>
-const T& Deque<T>::at(size_t index) const {
+template<typename T, size_t ChunkBytes, typename Allocator>
+const T& Deque<T, ChunkBytes, Allocator>::at(size_t index) const {
     if (index >= deque_size)
         throw std::out_of_range("Error: out of range");
     return (*this)[index];
 }
 
-template<typename T>
-void Deque<T>::push_back(const T& value) {
-    if (last_element_location == std::make_pair(array.size() - 1, chunk_capacity - 1)) {
-        array.resize(2 * array.size());
-
-        for (size_t i = array.size()/2; i < array.size(); ++i) {
-            array[i] = reinterpret_cast<T*>(new int8_t[chunk_capacity * sizeof(T)]);
-        }
-    }
-
-    if (last_element_location.second == chunk_capacity - 1)
-        ++last_element_location.first;
+template<typename T, size_t ChunkBytes, typename Allocator>
+void Deque<T, ChunkBytes, Allocator>::push_back(const T& value) {
+    emplace_back(value);
+}
 
-    ++last_element_location.second;
-    last_element_location.second %= chunk_capacity;
+template<typename T, size_t ChunkBytes, typename Allocator>
+void Deque<T, ChunkBytes, Allocator>::push_back(T&& value) {
+    emplace_back(std::move(value));
+}
 
-    new (array[last_element_location.first] + last_element_location.second) T(value);
+template<typename T, size_t ChunkBytes, typename Allocator>
+template<typename... Args>
+T& Deque<T, ChunkBytes, Allocator>::emplace_back(Args&&... args) {
+    if (array.empty() || last_element_location.first + 2 >= array.size())
+        reallocate_map(false);
+
+    std::pair<size_t, size_t> new_location = last_element_location;
+    if (new_location.second == chunk_capacity - 1)
+        ++new_location.first;
+
+    ++new_location.second;
+    new_location.second &= chunk_mask;
+
+    T*& chunk = array[new_location.first];
+    bool fresh_chunk = (chunk == nullptr);
+    if (fresh_chunk)
+        chunk = acquire_chunk();
+
+    T* element;
+    try {
+        AllocatorTraits::construct(allocator, chunk + new_location.second, std::forward<Args>(args)...);
+        element = chunk + new_location.second;
+    } catch (...) {
+        if (fresh_chunk)
+            release_chunk(chunk);
+        throw;
+    }
+    last_element_location = new_location;
     ++deque_size;
+    return *element;
 }
 
-template<typename T>
-void Deque<T>::pop_back() {
+template<typename T, size_t ChunkBytes, typename Allocator>
+void Deque<T, ChunkBytes, Allocator>::pop_back() {
     if (size() == 0)
         return;
 
-    (array[last_element_location.first] + last_element_location.second)->~T();
+    AllocatorTraits::destroy(allocator, array[last_element_location.first] + last_element_location.second);
 
-    if (last_element_location.second == 0)
+    if (last_element_location.second == 0) {
+        release_chunk(array[last_element_location.first]);
         --last_element_location.first;
+    }
 
-    last_element_location.second = (chunk_capacity + last_element_location.second - 1) % chunk_capacity;
+    last_element_location.second = (last_element_location.second - 1) & chunk_mask;
 
     --deque_size;
 }
 
-template<typename T>
-void Deque<T>::push_front(const T& value) {
-    if (first_element_location == std::make_pair(size_t(0), size_t(0))) {
-        array.resize(2 * array.size());
+template<typename T, size_t ChunkBytes, typename Allocator>
+void Deque<T, ChunkBytes, Allocator>::push_front(const T& value) {
+    emplace_front(value);
+}
 
-        first_element_location.first = array.size()/2;
-        last_element_location.first += array.size()/2;
+template<typename T, size_t ChunkBytes, typename Allocator>
+void Deque<T, ChunkBytes, Allocator>::push_front(T&& value) {
+    emplace_front(std::move(value));
+}
 
-        for(size_t i = 0; i < array.size()/2 ; ++i) {
-            array[array.size()/2 + i] = array[i];
-            array[i] = reinterpret_cast<T*>(new int8_t[chunk_capacity * sizeof(T)]);
-        }
-    }
+template<typename T, size_t ChunkBytes, typename Allocator>
+template<typename... Args>
+T& Deque<T, ChunkBytes, Allocator>::emplace_front(Args&&... args) {
+    if (array.empty() || first_element_location == std::make_pair(size_t(0), size_t(0)))
+        reallocate_map(true);
 
-    if (first_element_location.second == 0) {
-        --first_element_location.first;
-        first_element_location.second = chunk_capacity - 1;
+    std::pair<size_t, size_t> new_location = first_element_location;
+    if (new_location.second == 0) {
+        --new_location.first;
+        new_location.second = chunk_capacity - 1;
     } else {
-        --first_element_location.second;
+        --new_location.second;
     }
 
-    new(array[first_element_location.first] + first_element_location.second) T(value);
+    T*& chunk = array[new_location.first];
+    bool fresh_chunk = (chunk == nullptr);
+    if (fresh_chunk)
+        chunk = acquire_chunk();
+
+    T* element;
+    try {
+        AllocatorTraits::construct(allocator, chunk + new_location.second, std::forward<Args>(args)...);
+        element = chunk + new_location.second;
+    } catch (...) {
+        if (fresh_chunk)
+            release_chunk(chunk);
+        throw;
+    }
+    first_element_location = new_location;
     ++deque_size;
+    return *element;
 }
 
-template<typename T>
-void Deque<T>::pop_front() {
+template<typename T, size_t ChunkBytes, typename Allocator>
+void Deque<T, ChunkBytes, Allocator>::pop_front() {
     if (size() == 0)
         return;
 
     --deque_size;
 
-    (array[first_element_location.first] + first_element_location.second)->~T();
+    AllocatorTraits::destroy(allocator, array[first_element_location.first] + first_element_location.second);
     if (first_element_location.second == chunk_capacity - 1) {
+        release_chunk(array[first_element_location.first]);
         first_element_location.second = 0;
         ++first_element_location.first;
     } else {
@@ -334,20 +773,726 @@ void Deque<T>::pop_front() {
     }
 }
 
-template<typename T>
-void Deque<T>::insert(iterator needed_iterator, const T& value) {
-    push_back(value);
-    auto iter = --end() + 1;
-    while (--iter != needed_iterator) {
-        std::iter_swap(iter, iter - 1);
+template<typename T, size_t ChunkBytes, typename Allocator>
+T* Deque<T, ChunkBytes, Allocator>::element_pointer(size_t index) const {
+    size_t offset = first_element_location.second + index;
+    return array[first_element_location.first + (offset >> chunk_shift)] + (offset & chunk_mask);
+}
+
+template<typename T, size_t ChunkBytes, typename Allocator>
+size_t Deque<T, ChunkBytes, Allocator>::chunk_offset(size_t index) const {
+    return (first_element_location.second + index) & chunk_mask;
+}
+
+// Moves [from, from + count) to [to, to + count) for to < from, one contiguous chunk span at a time.
+template<typename T, size_t ChunkBytes, typename Allocator>
+void Deque<T, ChunkBytes, Allocator>::move_elements(size_t from, size_t to, size_t count) {
+    while (count > 0) {
+        size_t span = std::min({count, chunk_capacity - chunk_offset(from), chunk_capacity - chunk_offset(to)});
+        T* source = element_pointer(from);
+        std::move(source, source + span, element_pointer(to));
+        from += span;
+        to += span;
+        count -= span;
+    }
+}
+
+// Same as move_elements for to > from, walking from the back.
+template<typename T, size_t ChunkBytes, typename Allocator>
+void Deque<T, ChunkBytes, Allocator>::move_elements_backward(size_t from, size_t to, size_t count) {
+    while (count > 0) {
+        size_t span = std::min({count, chunk_offset(from + count - 1) + 1, chunk_offset(to + count - 1) + 1});
+        T* source_end = element_pointer(from + count - 1) + 1;
+        std::move_backward(source_end - span, source_end, element_pointer(to + count - 1) + 1);
+        count -= span;
+    }
+}
+
+// Constructs count elements from first in front of the current first element, in order, so that
+// they end up at indices [0, count). The map must already have room (see reserve_map). If a
+// constructor throws, the elements built so far and their fresh chunks are released.
+template<typename T, size_t ChunkBytes, typename Allocator>
+template<typename InputIterator>
+void Deque<T, ChunkBytes, Allocator>::prepend(InputIterator first, size_t count) {
+    if (count == 0)
+        return;
+    reserve_map(true, count);
+
+    size_t start = first_element_location.first * chunk_capacity + first_element_location.second - count;
+    T*& boundary_chunk = array[first_element_location.first];
+    bool boundary_fresh = (boundary_chunk == nullptr);
+    size_t built = 0;
+    try {
+        for (; built < count; ++built, ++first) {
+            size_t position = start + built;
+            T*& chunk = array[position >> chunk_shift];
+            if (chunk == nullptr)
+                chunk = acquire_chunk();
+            AllocatorTraits::construct(allocator, chunk + (position & chunk_mask), *first);
+        }
+    } catch (...) {
+        for (size_t i = 0; i < built; ++i) {
+            size_t position = start + i;
+            AllocatorTraits::destroy(allocator, array[position >> chunk_shift] + (position & chunk_mask));
+        }
+        for (size_t i = start >> chunk_shift; i < first_element_location.first; ++i) {
+            release_chunk(array[i]);
+        }
+        if (boundary_fresh)
+            release_chunk(boundary_chunk);
+        throw;
+    }
+    first_element_location = std::make_pair(start >> chunk_shift, start & chunk_mask);
+    deque_size += count;
+}
+
+template<typename T, size_t ChunkBytes, typename Allocator>
+template<typename Function>
+void Deque<T, ChunkBytes, Allocator>::for_each_segment(Function function) {
+    iterator first = begin();
+    iterator last = end();
+    while (first.node != last.node) {
+        function(first.current, first.chunk_end);
+        first.set_node(first.node + 1);
+        first.current = first.chunk_begin;
+    }
+    if (first.current != last.current)
+        function(first.current, last.current);
+}
+
+template<typename T, size_t ChunkBytes, typename Allocator>
+template<typename Function>
+void Deque<T, ChunkBytes, Allocator>::for_each_segment(Function function) const {
+    const_iterator first = begin();
+    const_iterator last = end();
+    while (first.node != last.node) {
+        function(static_cast<const T*>(first.current), static_cast<const T*>(first.chunk_end));
+        first.set_node(first.node + 1);
+        first.current = first.chunk_begin;
+    }
+    if (first.current != last.current)
+        function(static_cast<const T*>(first.current), static_cast<const T*>(last.current));
+}
+
+template<typename T, size_t ChunkBytes, typename Allocator>
+template<typename Iterator>
+Iterator Deque<T, ChunkBytes, Allocator>::find_in_segments(Iterator first, Iterator last, const T& value) {
+    while (first.node != last.node) {
+        T* found = std::find(first.current, first.chunk_end, value);
+        if (found != first.chunk_end) {
+            first.current = found;
+            return first;
+        }
+        first.set_node(first.node + 1);
+        first.current = first.chunk_begin;
+    }
+    first.current = std::find(first.current, last.current, value);
+    return first;
+}
+
+template<typename T, size_t ChunkBytes, typename Allocator>
+bool Deque<T, ChunkBytes, Allocator>::empty() const {
+    return deque_size == 0;
+}
+
+template<typename T, size_t ChunkBytes, typename Allocator>
+void Deque<T, ChunkBytes, Allocator>::clear() {
+    while (deque_size > 0) {
+        pop_back();
+    }
+}
+
+// Shifts whichever side of the position is shorter, so the cost is O(min(i, n - i)).
+template<typename T, size_t ChunkBytes, typename Allocator>
+template<typename... Args>
+void Deque<T, ChunkBytes, Allocator>::emplace(iterator needed_iterator, Args&&... args) {
+    size_t index = needed_iterator - begin();
+    if (index == 0) {
+        emplace_front(std::forward<Args>(args)...);
+        return;
+    }
+    if (index == deque_size) {
+        emplace_back(std::forward<Args>(args)...);
+        return;
+    }
+
+    T value(std::forward<Args>(args)...);
+    if (index < deque_size - index) {
+        emplace_front(std::move_if_noexcept(*element_pointer(0)));
+        move_elements(2, 1, index - 1);
+    } else {
+        emplace_back(std::move_if_noexcept(*element_pointer(deque_size - 1)));
+        move_elements_backward(index, index + 1, deque_size - 2 - index);
+    }
+    *element_pointer(index) = std::move(value);
+}
+
+template<typename T, size_t ChunkBytes, typename Allocator>
+void Deque<T, ChunkBytes, Allocator>::insert(iterator needed_iterator, const T& value) {
+    emplace(needed_iterator, value);
+}
+
+template<typename T, size_t ChunkBytes, typename Allocator>
+void Deque<T, ChunkBytes, Allocator>::insert(iterator needed_iterator, T&& value) {
+    emplace(needed_iterator, std::move(value));
+}
+
+// Opens a gap of count elements on the shorter side of the position: the elements nearest that end
+// are moved into fresh slots there, the rest slide over in chunk spans, and the new values are
+// constructed in the remaining fresh slots or assigned over the moved-from ones. If constructing a
+// fresh slot throws the deque is unchanged; a throwing assignment leaves it valid.
+template<typename T, size_t ChunkBytes, typename Allocator>
+template<typename ForwardIterator>
+void Deque<T, ChunkBytes, Allocator>::insert(iterator needed_iterator, ForwardIterator first, ForwardIterator last) {
+    size_t index = needed_iterator - begin();
+    size_t count = static_cast<size_t>(std::distance(first, last));
+    if (count == 0)
+        return;
+
+    size_t old_size = deque_size;
+    if (index < old_size - index) {
+        reserve_map(true, count);
+        if (index >= count) {
+            prepend(move_if_noexcept_iterator(begin()), count);
+            move_elements(2 * count, count, index - count);
+            std::copy(first, last, begin() + index);
+        } else {
+            ForwardIterator middle = std::next(first, count - index);
+            prepend(first, count - index);
+            try {
+                prepend(move_if_noexcept_iterator(begin() + (count - index)), index);
+            } catch (...) {
+                for (size_t i = index; i < count; ++i) {
+                    pop_front();
+                }
+                throw;
+            }
+            std::copy(middle, last, begin() + count);
+        }
+    } else {
+        size_t tail = old_size - index;
+        ForwardIterator middle = first;
+        reserve_map(false, count);
+        try {
+            if (tail >= count) {
+                for (size_t i = old_size - count; i < old_size; ++i) {
+                    emplace_back(std::move_if_noexcept(*element_pointer(i)));
+                }
+            } else {
+                middle = std::next(first, tail);
+                append(middle, last);
+                for (size_t i = index; i < old_size; ++i) {
+                    emplace_back(std::move_if_noexcept(*element_pointer(i)));
+                }
+            }
+        } catch (...) {
+            while (deque_size > old_size) {
+                pop_back();
+            }
+            throw;
+        }
+        if (tail >= count) {
+            move_elements_backward(index, index + count, tail - count);
+            std::copy(first, last, begin() + index);
+        } else {
+            std::copy(first, middle, begin() + index);
+        }
     }
 }
 
-template<typename T>
-void Deque<T>::erase(iterator needed_iterator) {
-    auto iter = needed_iterator - 1;
-    while (++iter != --end()) {
-        std::iter_swap(iter, iter + 1);
+template<typename T, size_t ChunkBytes, typename Allocator>
+void Deque<T, ChunkBytes, Allocator>::erase(iterator needed_iterator) {
+    erase(needed_iterator, needed_iterator + 1);
+}
+
+template<typename T, size_t ChunkBytes, typename Allocator>
+void Deque<T, ChunkBytes, Allocator>::erase(iterator first, iterator last) {
+    size_t from = first - begin();
+    size_t to = last - begin();
+    size_t count = to - from;
+    if (count == 0)
+        return;
+
+    if (from < deque_size - to) {
+        move_elements_backward(0, count, from);
+        for (size_t i = 0; i < count; ++i) {
+            pop_front();
+        }
+    } else {
+        move_elements(to, from, deque_size - to);
+        for (size_t i = 0; i < count; ++i) {
+            pop_back();
+        }
+    }
+}
+
+template<typename T, size_t ChunkBytes, typename Allocator>
+template<typename InputIterator>
+void Deque<T, ChunkBytes, Allocator>::append(InputIterator first, InputIterator last) {
+    size_t old_size = deque_size;
+    try {
+        for (; first != last; ++first) {
+            emplace_back(*first);
+        }
+    } catch (...) {
+        while (deque_size > old_size) {
+            pop_back();
+        }
+        throw;
     }
-    pop_back();
 }
+
+template<typename T, size_t ChunkBytes, typename Allocator>
+template<typename InputIterator>
+void Deque<T, ChunkBytes, Allocator>::assign(InputIterator first, InputIterator last) {
+    Deque replacement(allocator);
+    replacement.append(first, last);
+    swap_storage<false>(replacement);
+}
+
+template<typename T, size_t ChunkBytes, typename Allocator>
+void Deque<T, ChunkBytes, Allocator>::assign(size_t count, const T& value) {
+    Deque replacement(allocator);
+    for (size_t i = 0; i < count; ++i) {
+        replacement.emplace_back(value);
+    }
+    swap_storage<false>(replacement);
+}
+
+
+    /*              SpscDeque                */
+
+
+// Unbounded single-producer/single-consumer queue with the chunk layout of Deque. Chunks are
+// linked in order: the producer constructs at the back and publishes with a release store of
+// the back index, the consumer pops at the front after an acquire load of it. Drained chunks
+// are handed back to the producer through a small lock-free spare cache.
+template <typename T, size_t ChunkBytes = 4096>
+class SpscDeque {
+private:
+    using Layout = Deque<T, ChunkBytes>;
+    static constexpr size_t chunk_capacity = Layout::chunk_capacity;
+    static constexpr size_t chunk_mask = Layout::chunk_mask;
+    static constexpr size_t chunk_alignment = Layout::chunk_alignment;
+    static constexpr size_t cache_line = 64;
+    static const size_t spare_chunks_limit = Layout::spare_chunks_limit;
+
+    struct Chunk {
+        typename Layout::chunk_storage storage;
+        std::atomic<Chunk*> next{nullptr};
+
+        T* slot(size_t index) { return reinterpret_cast<T*>(storage.bytes) + index; }
+    };
+
+    std::atomic<Chunk*> spare_chunks[spare_chunks_limit] = {};
+
+    // Consumer side.
+    alignas(cache_line) Chunk* front_chunk;
+    size_t front_chunk_index = 0;
+    std::atomic<size_t> front_index{0};
+    size_t cached_back_index = 0;
+
+    // Producer side.
+    alignas(cache_line) Chunk* back_chunk;
+    std::atomic<size_t> back_index{0};
+
+    static Chunk* allocate_chunk() {
+        return new (::operator new(sizeof(Chunk), std::align_val_t(alignof(Chunk)))) Chunk();
+    }
+
+    static void deallocate_chunk(Chunk* chunk) {
+        chunk->~Chunk();
+        ::operator delete(chunk, std::align_val_t(alignof(Chunk)));
+    }
+
+    Chunk* acquire_chunk() {
+        for (auto& spare : spare_chunks) {
+            Chunk* chunk = spare.exchange(nullptr, std::memory_order_acquire);
+            if (chunk != nullptr) {
+                chunk->next.store(nullptr, std::memory_order_relaxed);
+                return chunk;
+            }
+        }
+        return allocate_chunk();
+    }
+
+    void release_chunk(Chunk* chunk) {
+        for (auto& spare : spare_chunks) {
+            Chunk* expected = nullptr;
+            if (spare.compare_exchange_strong(expected, chunk, std::memory_order_release, std::memory_order_relaxed))
+                return;
+        }
+        deallocate_chunk(chunk);
+    }
+
+public:
+    SpscDeque(): front_chunk(allocate_chunk()), back_chunk(front_chunk) {}
+    SpscDeque(const SpscDeque&) = delete;
+    SpscDeque& operator=(const SpscDeque&) = delete;
+
+    ~SpscDeque() {
+        while (front() != nullptr)
+            pop_front();
+        while (front_chunk != nullptr) {
+            Chunk* next = front_chunk->next.load(std::memory_order_relaxed);
+            deallocate_chunk(front_chunk);
+            front_chunk = next;
+        }
+        for (auto& spare : spare_chunks) {
+            Chunk* chunk = spare.load(std::memory_order_relaxed);
+            if (chunk != nullptr)
+                deallocate_chunk(chunk);
+        }
+    }
+
+    // Producer only.
+    template <typename... Args>
+    void emplace_back(Args&&... args) {
+        size_t index = back_index.load(std::memory_order_relaxed);
+        size_t offset = index & chunk_mask;
+        if (offset == 0 && index != 0) {
+            // The element goes into the new chunk before the chunk is linked, so a throwing
+            // constructor leaves no empty chunk in the chain.
+            Chunk* chunk = acquire_chunk();
+            try {
+                new (chunk->slot(0)) T(std::forward<Args>(args)...);
+            } catch (...) {
+                release_chunk(chunk);
+                throw;
+            }
+            back_chunk->next.store(chunk, std::memory_order_relaxed);
+            back_chunk = chunk;
+        } else {
+            new (back_chunk->slot(offset)) T(std::forward<Args>(args)...);
+        }
+        back_index.store(index + 1, std::memory_order_release);
+    }
+
+    void push_back(const T& value) { emplace_back(value); }
+    void push_back(T&& value) { emplace_back(std::move(value)); }
+
+    // Consumer only: the front element, or nullptr if nothing has been published yet.
+    T* front() {
+        size_t index = front_index.load(std::memory_order_relaxed);
+        if (index == cached_back_index) {
+            cached_back_index = back_index.load(std::memory_order_acquire);
+            if (index == cached_back_index)
+                return nullptr;
+        }
+        if (index - front_chunk_index == chunk_capacity) {
+            // The producer linked the next chunk before publishing any element in it.
+            Chunk* next = front_chunk->next.load(std::memory_order_relaxed);
+            release_chunk(front_chunk);
+            front_chunk = next;
+            front_chunk_index = index;
+        }
+        return front_chunk->slot(index & chunk_mask);
+    }
+
+    // Consumer only; requires front() != nullptr.
+    void pop_front() {
+        size_t index = front_index.load(std::memory_order_relaxed);
+        front_chunk->slot(index & chunk_mask)->~T();
+        front_index.store(index + 1, std::memory_order_release);
+    }
+
+    // Consumer only.
+    bool try_pop_front(T& value) {
+        T* element = front();
+        if (element == nullptr)
+            return false;
+        value = std::move(*element);
+        pop_front();
+        return true;
+    }
+
+    // Exact when called from either endpoint while the other one is idle, approximate otherwise.
+    size_t size() const {
+        size_t front_position = front_index.load(std::memory_order_acquire);
+        return back_index.load(std::memory_order_acquire) - front_position;
+    }
+
+    bool empty() const { return size() == 0; }
+};
+
+
+    /*              WorkStealingDeque                */
+
+
+// Chase-Lev work-stealing deque (in the formulation of Le, Pop, Cohen and Zappa Nardelli): the
+// owner thread pushes and pops at the back, any other thread steals from the front. Elements
+// live in a circular array that starts at one Deque chunk and doubles when full; retired arrays
+// are kept until destruction because a thief may still be reading from them.
+template <typename T, size_t ChunkBytes = 4096>
+class WorkStealingDeque {
+private:
+    static_assert(std::is_trivially_copyable<T>::value, "WorkStealingDeque stores elements in atomics");
+
+    static constexpr size_t cache_line = 64;
+
+    struct Ring {
+        size_t mask;
+        std::unique_ptr<std::atomic<T>[]> slots;
+
+        explicit Ring(size_t capacity): mask(capacity - 1), slots(new std::atomic<T>[capacity]) {}
+
+        size_t capacity() const { return mask + 1; }
+        T get(int64_t index) const { return slots[index & mask].load(std::memory_order_relaxed); }
+        void put(int64_t index, T value) { slots[index & mask].store(value, std::memory_order_relaxed); }
+    };
+
+    alignas(cache_line) std::atomic<int64_t> top{0};
+    alignas(cache_line) std::atomic<int64_t> bottom{0};
+    std::atomic<Ring*> ring;
+    std::vector<std::unique_ptr<Ring>> rings;
+
+    Ring* grow(Ring* old_ring, int64_t first, int64_t last) {
+        rings.emplace_back(new Ring(2 * old_ring->capacity()));
+        Ring* new_ring = rings.back().get();
+        for (int64_t i = first; i < last; ++i)
+            new_ring->put(i, old_ring->get(i));
+        ring.store(new_ring, std::memory_order_release);
+        return new_ring;
+    }
+
+public:
+    WorkStealingDeque() {
+        rings.emplace_back(new Ring(Deque<T, ChunkBytes>::chunk_capacity));
+        ring.store(rings.back().get(), std::memory_order_relaxed);
+    }
+
+    WorkStealingDeque(const WorkStealingDeque&) = delete;
+    WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+    // Owner only.
+    void push_back(T value) {
+        int64_t last = bottom.load(std::memory_order_relaxed);
+        int64_t first = top.load(std::memory_order_acquire);
+        Ring* current_ring = ring.load(std::memory_order_relaxed);
+        if (last - first > static_cast<int64_t>(current_ring->mask))
+            current_ring = grow(current_ring, first, last);
+        current_ring->put(last, value);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom.store(last + 1, std::memory_order_relaxed);
+    }
+
+    // Owner only.
+    bool try_pop_back(T& value) {
+        int64_t last = bottom.load(std::memory_order_relaxed) - 1;
+        Ring* current_ring = ring.load(std::memory_order_relaxed);
+        bottom.store(last, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t first = top.load(std::memory_order_relaxed);
+        if (first > last) {
+            bottom.store(last + 1, std::memory_order_relaxed);
+            return false;
+        }
+        value = current_ring->get(last);
+        if (first == last) {
+            // Last element: race against thieves for it.
+            bool won = top.compare_exchange_strong(first, first + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+            bottom.store(last + 1, std::memory_order_relaxed);
+            return won;
+        }
+        return true;
+    }
+
+    // Any thread. Fails if the deque is empty or another thread won the race for the front.
+    bool try_steal_front(T& value) {
+        int64_t first = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t last = bottom.load(std::memory_order_acquire);
+        if (first >= last)
+            return false;
+        value = ring.load(std::memory_order_acquire)->get(first);
+        return top.compare_exchange_strong(first, first + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+    }
+
+    size_t size() const {
+        int64_t first = top.load(std::memory_order_relaxed);
+        int64_t last = bottom.load(std::memory_order_relaxed);
+        return last > first ? static_cast<size_t>(last - first) : 0;
+    }
+
+    bool empty() const { return size() == 0; }
+};
+
+
+    /*              WorkStealingPool                */
+
+
+// Fixed set of worker threads, each owning a WorkStealingDeque of tasks. Tasks submitted from a
+// worker go to its own deque; tasks from other threads go to a shared injection queue. Idle
+// workers drain their deque, then the injection queue, then steal from the other workers.
+class WorkStealingPool {
+private:
+    using Task = std::function<void()>;
+
+    struct Worker {
+        WorkStealingDeque<Task*> tasks;
+        std::thread thread;
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::mutex mutex;
+    std::condition_variable work_available;
+    std::condition_variable all_done;
+    Deque<Task*> injected;
+    std::atomic<size_t> queued{0};
+    std::atomic<size_t> unfinished{0};
+    bool stopping = false;
+
+    static WorkStealingPool*& current_pool() {
+        static thread_local WorkStealingPool* pool = nullptr;
+        return pool;
+    }
+
+    static size_t& current_index() {
+        static thread_local size_t index = 0;
+        return index;
+    }
+
+    Task* find_task(size_t index) {
+        Task* task = nullptr;
+        if (workers[index]->tasks.try_pop_back(task))
+            return task;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!injected.empty()) {
+                task = injected[0];
+                injected.pop_front();
+                return task;
+            }
+        }
+        for (size_t i = 1; i < workers.size(); ++i) {
+            if (workers[(index + i) % workers.size()]->tasks.try_steal_front(task))
+                return task;
+        }
+        return nullptr;
+    }
+
+    void run(Task* task) {
+        queued.fetch_sub(1, std::memory_order_relaxed);
+        (*task)();
+        delete task;
+        if (unfinished.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            std::lock_guard<std::mutex> lock(mutex);
+            all_done.notify_all();
+        }
+    }
+
+    void worker_loop(size_t index) {
+        current_pool() = this;
+        current_index() = index;
+        while (true) {
+            Task* task = find_task(index);
+            if (task != nullptr) {
+                run(task);
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(mutex);
+            work_available.wait(lock, [this] { return stopping || queued.load(std::memory_order_relaxed) > 0; });
+            if (stopping && queued.load(std::memory_order_relaxed) == 0)
+                return;
+        }
+    }
+
+    void schedule(Task* task) {
+        unfinished.fetch_add(1, std::memory_order_relaxed);
+        queued.fetch_add(1, std::memory_order_release);
+        if (current_pool() == this) {
+            workers[current_index()]->tasks.push_back(task);
+        } else {
+            std::lock_guard<std::mutex> lock(mutex);
+            injected.push_back(task);
+        }
+        {
+            // Pairs with the predicate check in worker_loop so that the wakeup cannot be lost.
+            std::lock_guard<std::mutex> lock(mutex);
+        }
+        work_available.notify_one();
+    }
+
+public:
+    explicit WorkStealingPool(size_t threads = std::max(1u, std::thread::hardware_concurrency())) {
+        for (size_t i = 0; i < std::max<size_t>(threads, 1); ++i)
+            workers.emplace_back(new Worker());
+        for (size_t i = 0; i < workers.size(); ++i)
+            workers[i]->thread = std::thread(&WorkStealingPool::worker_loop, this, i);
+    }
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    ~WorkStealingPool() {
+        wait();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        work_available.notify_all();
+        for (auto& worker : workers)
+            worker->thread.join();
+    }
+
+    size_t size() const { return workers.size(); }
+
+    template <typename Function>
+    auto submit(Function&& function) -> std::future<decltype(function())> {
+        using Result = decltype(function());
+        auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<Function>(function));
+        std::future<Result> result = packaged->get_future();
+        schedule(new Task([packaged] { (*packaged)(); }));
+        return result;
+    }
+
+    // Waits for a result; a worker thread keeps executing other tasks meanwhile instead of blocking.
+    template <typename Result>
+    Result get(std::future<Result>& result) {
+        if (current_pool() == this) {
+            while (result.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+                Task* task = find_task(current_index());
+                if (task != nullptr)
+                    run(task);
+                else
+                    std::this_thread::yield();
+            }
+        }
+        return result.get();
+    }
+
+    // Runs function(i) for every i in [first, last) in about four tasks per worker, each covering
+    // at least grain indices. May be called from inside a task. The parts refer to function, so all
+    // of them are waited for before the first exception thrown by any of them is rethrown.
+    template <typename Function>
+    void parallel_for(size_t first, size_t last, Function function, size_t grain = 1) {
+        if (first >= last)
+            return;
+        grain = std::max<size_t>(grain, (last - first + 4 * size() - 1) / (4 * size()));
+        std::vector<std::future<void>> parts;
+        for (size_t begin = first; begin < last; begin += grain) {
+            size_t end = std::min(last, begin + grain);
+            parts.push_back(submit([&function, begin, end] {
+                for (size_t i = begin; i < end; ++i)
+                    function(i);
+            }));
+        }
+        std::exception_ptr error;
+        for (auto& part : parts) {
+            try {
+                get(part);
+            } catch (...) {
+                if (!error)
+                    error = std::current_exception();
+            }
+        }
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+    // Blocks until every submitted task has finished. Must not be called from a worker.
+    void wait() {
+        std::unique_lock<std::mutex> lock(mutex);
+        all_done.wait(lock, [this] { return unfinished.load(std::memory_order_acquire) == 0; });
+    }
+};
@@ -2,6 +2,13 @@
 #include <vector>
 #include <string>
 #include <initializer_list>
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+#include <random>
+#include <cmath>
+#include <limits>
+#include <cstdint>
 
 class BigInteger;
 
@@ -745,17 +752,17 @@ class Residue {
 private:
     int number;
 
-    template <size_t D, size_t P, bool greater_than_root = false>
-    struct Divides {
-        static const bool result = (P % D) && Divides<D + 1, P, (D*D > P)>::result;
-    };
-
-    template <size_t D, size_t P>
-    struct Divides<D, P, true> {
-        static const bool result = true;
-    };
-
 public:
+    static constexpr bool is_prime() {
+        if (N < 2)
+            return false;
+        for (size_t d = 2; d * d <= N; ++d) {
+            if (N % d == 0)
+                return false;
+        }
+        return true;
+    }
+
     explicit Residue(long long num) {
         if (num >= 0)
             number = num % int(N);
@@ -767,11 +774,15 @@ public:
     };
 
     Residue power_for_fermat(size_t ex) const {
-        if (ex == 0) return Residue(1);
-        if (ex % 2 == 1)
-            return power_for_fermat(ex - 1) * (*this);
-        else
-            return power_for_fermat(ex / 2) * power_for_fermat(ex / 2);
+        Residue result(1);
+        Residue base = *this;
+        while (ex > 0) {
+            if (ex % 2 == 1)
+                result *= base;
+            base *= base;
+            ex /= 2;
+        }
+        return result;
     }
 
     void normalize() {
@@ -785,25 +796,25 @@ public:
     }
 
     Residue &operator+=(const Residue &num) {
-        number = (number + num.number) % int(N);
+        number = static_cast<int>((static_cast<long long>(number) + num.number) % static_cast<long long>(N));
         normalize();
         return *this;
     }
 
     Residue &operator-=(const Residue &num) {
-        number = (number - num.number) % int(N);
+        number = static_cast<int>((static_cast<long long>(number) - num.number) % static_cast<long long>(N));
         normalize();
         return *this;
     }
 
     Residue &operator*=(const Residue &num) {
-        number = (number * num.number) % int(N);
+        number = static_cast<int>((static_cast<long long>(number) * num.number) % static_cast<long long>(N));
         normalize();
         return *this;
     }
 
     Residue &operator/=(const Residue &num) {
-        static_assert(Divides<2, N, false>::result);
+        static_assert(is_prime());
         *this *= num.power_for_fermat(N - 2);
         normalize();
         return *this;
@@ -869,6 +880,475 @@ bool operator!=(const Residue<N> &twin1, const Residue<N> &twin2) {
     return !(twin1 == twin2);
 }
 
+template <typename Field>
+struct NumberTheoreticTransform {
+    static bool applicable(size_t) {
+        return false;
+    }
+
+    static void transform(std::vector<Field> &, bool) {}
+};
+
+template <size_t N>
+struct NumberTheoreticTransform<Residue<N>> {
+    static size_t max_length() {
+        size_t length = 1;
+        while ((N - 1) % (2 * length) == 0)
+            length *= 2;
+        return length;
+    }
+
+    static bool applicable(size_t length) {
+        return Residue<N>::is_prime() && N > 2 && length <= max_length();
+    }
+
+    static Residue<N> primitive_root() {
+        static const Residue<N> root = find_primitive_root();
+        return root;
+    }
+
+    static Residue<N> find_primitive_root() {
+        std::vector<size_t> divisors;
+        size_t rest = N - 1;
+        for (size_t d = 2; d * d <= rest; ++d) {
+            if (rest % d != 0)
+                continue;
+            divisors.push_back(d);
+            while (rest % d == 0)
+                rest /= d;
+        }
+        if (rest > 1)
+            divisors.push_back(rest);
+
+        for (size_t g = 2; ; ++g) {
+            bool generates = true;
+            for (size_t d : divisors) {
+                if (Residue<N>(g).power_for_fermat((N - 1) / d) == Residue<N>(1)) {
+                    generates = false;
+                    break;
+                }
+            }
+            if (generates)
+                return Residue<N>(g);
+        }
+    }
+
+    static void transform(std::vector<Residue<N>> &values, bool inverse) {
+        size_t n = values.size();
+        for (size_t i = 1, j = 0; i < n; ++i) {
+            size_t bit = n / 2;
+            for (; j & bit; bit /= 2)
+                j ^= bit;
+            j ^= bit;
+            if (i < j)
+                std::swap(values[i], values[j]);
+        }
+
+        std::vector<Residue<N>> roots(n / 2, Residue<N>(1));
+        for (size_t length = 2; length <= n; length *= 2) {
+            Residue<N> step = primitive_root().power_for_fermat((N - 1) / length);
+            if (inverse)
+                step = Residue<N>(1) / step;
+            size_t half = length / 2;
+            for (size_t j = 1; j < half; ++j)
+                roots[j] = roots[j - 1] * step;
+
+            for (size_t i = 0; i < n; i += length) {
+                for (size_t j = 0; j < half; ++j) {
+                    Residue<N> u = values[i + j];
+                    Residue<N> v = values[i + j + half] * roots[j];
+                    values[i + j] = u + v;
+                    values[i + j + half] = u - v;
+                }
+            }
+        }
+
+        if (inverse) {
+            Residue<N> factor = Residue<N>(1) / Residue<N>(static_cast<long long>(n));
+            for (auto &value : values)
+                value *= factor;
+        }
+    }
+};
+
+template <typename Field = Rational>
+class Polynomial {
+private:
+    std::vector<Field> coefficient;
+    static const size_t naive_threshold = 32;
+
+    void trim() {
+        while (!coefficient.empty() && coefficient.back() == Field(0))
+            coefficient.pop_back();
+    }
+
+    static std::vector<Field> multiply(const std::vector<Field> &first, const std::vector<Field> &second) {
+        if (first.empty() || second.empty())
+            return {};
+        size_t result_size = first.size() + second.size() - 1;
+        size_t length = 1;
+        while (length < result_size)
+            length *= 2;
+
+        if (std::min(first.size(), second.size()) <= naive_threshold || !NumberTheoreticTransform<Field>::applicable(length)) {
+            std::vector<Field> result(result_size, Field(0));
+            for (size_t i = 0; i < first.size(); ++i) {
+                if (first[i] == Field(0))
+                    continue;
+                for (size_t j = 0; j < second.size(); ++j) {
+                    result[i + j] += first[i] * second[j];
+                }
+            }
+            return result;
+        }
+
+        std::vector<Field> first_image = first;
+        std::vector<Field> second_image = second;
+        first_image.resize(length, Field(0));
+        second_image.resize(length, Field(0));
+        NumberTheoreticTransform<Field>::transform(first_image, false);
+        NumberTheoreticTransform<Field>::transform(second_image, false);
+        for (size_t i = 0; i < length; ++i) {
+            first_image[i] *= second_image[i];
+        }
+        NumberTheoreticTransform<Field>::transform(first_image, true);
+        first_image.resize(result_size, Field(0));
+        return first_image;
+    }
+
+    static void build_subproduct_tree(std::vector<Polynomial> &tree, size_t vertex, const std::vector<Field> &points, size_t left, size_t right) {
+        if (right - left == 1) {
+            tree[vertex] = Polynomial(std::vector<Field>{-points[left], Field(1)});
+            return;
+        }
+        size_t middle = (left + right) / 2;
+        build_subproduct_tree(tree, 2 * vertex, points, left, middle);
+        build_subproduct_tree(tree, 2 * vertex + 1, points, middle, right);
+        tree[vertex] = tree[2 * vertex] * tree[2 * vertex + 1];
+    }
+
+    void evaluate_down(const std::vector<Polynomial> &tree, size_t vertex, const std::vector<Field> &points,
+                       size_t left, size_t right, std::vector<Field> &values) const {
+        if (right - left <= naive_threshold) {
+            for (size_t i = left; i < right; ++i) {
+                values[i] = (*this)(points[i]);
+            }
+            return;
+        }
+        size_t middle = (left + right) / 2;
+        (*this % tree[2 * vertex]).evaluate_down(tree, 2 * vertex, points, left, middle, values);
+        (*this % tree[2 * vertex + 1]).evaluate_down(tree, 2 * vertex + 1, points, middle, right, values);
+    }
+
+    static Polynomial interpolate_up(const std::vector<Polynomial> &tree, size_t vertex, const std::vector<Field> &weights,
+                                     size_t left, size_t right) {
+        if (right - left == 1)
+            return Polynomial(weights[left]);
+        size_t middle = (left + right) / 2;
+        Polynomial left_part = interpolate_up(tree, 2 * vertex, weights, left, middle);
+        Polynomial right_part = interpolate_up(tree, 2 * vertex + 1, weights, middle, right);
+        return left_part * tree[2 * vertex + 1] + right_part * tree[2 * vertex];
+    }
+
+public:
+    Polynomial() = default;
+    ~Polynomial() = default;
+
+    Polynomial(const Field &constant) : coefficient{constant} {
+        trim();
+    }
+
+    explicit Polynomial(std::vector<Field> coefficients) : coefficient(std::move(coefficients)) {
+        trim();
+    }
+
+    Polynomial(std::initializer_list<int> list) {
+        for (auto x : list) {
+            coefficient.push_back(Field(x));
+        }
+        trim();
+    }
+
+    int degree() const {
+        return static_cast<int>(coefficient.size()) - 1;
+    }
+
+    size_t size() const {
+        return coefficient.size();
+    }
+
+    const std::vector<Field> &coefficients() const {
+        return coefficient;
+    }
+
+    Field operator[](size_t ind) const {
+        return ind < coefficient.size() ? coefficient[ind] : Field(0);
+    }
+
+    Polynomial truncated(size_t length) const {
+        if (length >= coefficient.size())
+            return *this;
+        return Polynomial(std::vector<Field>(coefficient.begin(), coefficient.begin() + length));
+    }
+
+    Polynomial reversed(size_t length) const {
+        std::vector<Field> result(length, Field(0));
+        for (size_t i = 0; i < std::min(length, coefficient.size()); ++i) {
+            result[length - 1 - i] = coefficient[i];
+        }
+        return Polynomial(std::move(result));
+    }
+
+    Polynomial derivative() const {
+        std::vector<Field> result;
+        for (size_t i = 1; i < coefficient.size(); ++i) {
+            result.push_back(coefficient[i] * Field(static_cast<long long>(i)));
+        }
+        return Polynomial(std::move(result));
+    }
+
+    Polynomial &scale(const Field &multiple) {
+        for (auto &x : coefficient) {
+            x *= multiple;
+        }
+        trim();
+        return *this;
+    }
+
+    Polynomial &operator+=(const Polynomial &poly) {
+        if (coefficient.size() < poly.coefficient.size())
+            coefficient.resize(poly.coefficient.size(), Field(0));
+        for (size_t i = 0; i < poly.coefficient.size(); ++i) {
+            coefficient[i] += poly.coefficient[i];
+        }
+        trim();
+        return *this;
+    }
+
+    Polynomial &operator-=(const Polynomial &poly) {
+        if (coefficient.size() < poly.coefficient.size())
+            coefficient.resize(poly.coefficient.size(), Field(0));
+        for (size_t i = 0; i < poly.coefficient.size(); ++i) {
+            coefficient[i] -= poly.coefficient[i];
+        }
+        trim();
+        return *this;
+    }
+
+    Polynomial &operator*=(const Polynomial &poly) {
+        coefficient = multiply(coefficient, poly.coefficient);
+        trim();
+        return *this;
+    }
+
+    Polynomial operator-() const {
+        Polynomial result = *this;
+        for (auto &x : result.coefficient) {
+            x = -x;
+        }
+        return result;
+    }
+
+    // Power series inverse modulo x^length by Newton iteration: g <- g * (2 - f * g).
+    Polynomial inverse(size_t length) const {
+        if (coefficient.empty() || coefficient[0] == Field(0))
+            throw std::invalid_argument("Error: series is not invertible");
+        Polynomial result(Field(1) / coefficient[0]);
+        for (size_t current = 1; current < length; current *= 2) {
+            Polynomial correction = Polynomial(Field(2)) - (truncated(2 * current) * result).truncated(2 * current);
+            result = (result * correction).truncated(2 * current);
+        }
+        return result.truncated(length);
+    }
+
+    std::pair<Polynomial, Polynomial> divide(const Polynomial &divisor) const {
+        if (divisor.coefficient.empty())
+            throw std::invalid_argument("Error: division by zero polynomial");
+        if (coefficient.size() < divisor.coefficient.size())
+            return {Polynomial(), *this};
+
+        size_t quotient_size = coefficient.size() - divisor.coefficient.size() + 1;
+        if (std::min(quotient_size, divisor.coefficient.size()) <= naive_threshold) {
+            std::vector<Field> rest = coefficient;
+            std::vector<Field> quotient(quotient_size, Field(0));
+            Field lead_inverse = Field(1) / divisor.coefficient.back();
+            for (size_t i = quotient_size; i-- > 0;) {
+                Field factor = rest[i + divisor.coefficient.size() - 1] * lead_inverse;
+                quotient[i] = factor;
+                if (factor == Field(0))
+                    continue;
+                for (size_t j = 0; j < divisor.coefficient.size(); ++j) {
+                    rest[i + j] -= factor * divisor.coefficient[j];
+                }
+            }
+            rest.resize(divisor.coefficient.size() - 1, Field(0));
+            return {Polynomial(std::move(quotient)), Polynomial(std::move(rest))};
+        }
+
+        Polynomial quotient = reversed(coefficient.size()).truncated(quotient_size);
+        quotient *= divisor.reversed(divisor.coefficient.size()).inverse(quotient_size);
+        quotient = quotient.truncated(quotient_size).reversed(quotient_size);
+        Polynomial remainder = *this - divisor * quotient;
+        return {quotient, remainder};
+    }
+
+    Polynomial &operator/=(const Polynomial &poly) {
+        *this = divide(poly).first;
+        return *this;
+    }
+
+    Polynomial &operator%=(const Polynomial &poly) {
+        *this = divide(poly).second;
+        return *this;
+    }
+
+    Field operator()(const Field &x) const {
+        Field result(0);
+        for (size_t i = coefficient.size(); i-- > 0;) {
+            result *= x;
+            result += coefficient[i];
+        }
+        return result;
+    }
+
+    std::vector<Field> evaluate(const std::vector<Field> &points) const {
+        std::vector<Field> values(points.size(), Field(0));
+        if (points.size() <= naive_threshold) {
+            for (size_t i = 0; i < points.size(); ++i) {
+                values[i] = (*this)(points[i]);
+            }
+            return values;
+        }
+        std::vector<Polynomial> tree(4 * points.size());
+        build_subproduct_tree(tree, 1, points, 0, points.size());
+        (*this % tree[1]).evaluate_down(tree, 1, points, 0, points.size(), values);
+        return values;
+    }
+
+    static Polynomial interpolate(const std::vector<Field> &points, const std::vector<Field> &values) {
+        if (points.empty())
+            return Polynomial();
+        std::vector<Polynomial> tree(4 * points.size());
+        build_subproduct_tree(tree, 1, points, 0, points.size());
+        std::vector<Field> weights = tree[1].derivative().evaluate(points);
+        for (size_t i = 0; i < points.size(); ++i) {
+            weights[i] = values[i] / weights[i];
+        }
+        return interpolate_up(tree, 1, weights, 0, points.size());
+    }
+
+    Polynomial monic() const {
+        if (coefficient.empty())
+            return *this;
+        Polynomial result = *this;
+        return result.scale(Field(1) / coefficient.back());
+    }
+
+    Polynomial gcd(const Polynomial &poly) const {
+        Polynomial first = *this;
+        Polynomial second = poly;
+        while (second.size() > 0) {
+            first %= second;
+            first.coefficient.swap(second.coefficient);
+        }
+        return first.monic();
+    }
+
+    Polynomial lcm(const Polynomial &poly) const {
+        if (coefficient.empty() || poly.coefficient.empty())
+            return Polynomial();
+        return (*this / gcd(poly) * poly).monic();
+    }
+
+    // Monic minimal polynomial of a linearly recurrent sequence (Berlekamp-Massey).
+    static Polynomial berlekamp_massey(const std::vector<Field> &sequence) {
+        std::vector<Field> current{Field(1)};
+        std::vector<Field> previous{Field(1)};
+        size_t length = 0;
+        size_t shift = 1;
+        Field previous_discrepancy(1);
+        for (size_t i = 0; i < sequence.size(); ++i) {
+            Field discrepancy(0);
+            for (size_t j = 0; j <= length && j < current.size(); ++j) {
+                discrepancy += current[j] * sequence[i - j];
+            }
+            if (discrepancy == Field(0)) {
+                ++shift;
+                continue;
+            }
+            Field factor = discrepancy / previous_discrepancy;
+            std::vector<Field> updated = current;
+            if (updated.size() < previous.size() + shift)
+                updated.resize(previous.size() + shift, Field(0));
+            for (size_t j = 0; j < previous.size(); ++j) {
+                updated[j + shift] -= factor * previous[j];
+            }
+            if (2 * length <= i) {
+                previous = current;
+                length = i + 1 - length;
+                previous_discrepancy = discrepancy;
+                shift = 1;
+            } else {
+                ++shift;
+            }
+            current = std::move(updated);
+        }
+        current.resize(length + 1, Field(0));
+        return Polynomial(std::move(current)).reversed(length + 1);
+    }
+
+    template <typename F>
+    friend bool operator==(const Polynomial<F> &twin1, const Polynomial<F> &twin2);
+};
+
+template <typename Field>
+Polynomial<Field> operator+(const Polynomial<Field> &first, const Polynomial<Field> &second) {
+    Polynomial<Field> copy = first;
+    copy += second;
+    return copy;
+}
+
+template <typename Field>
+Polynomial<Field> operator-(const Polynomial<Field> &first, const Polynomial<Field> &second) {
+    Polynomial<Field> copy = first;
+    copy -= second;
+    return copy;
+}
+
+template <typename Field>
+Polynomial<Field> operator*(const Polynomial<Field> &first, const Polynomial<Field> &second) {
+    Polynomial<Field> copy = first;
+    copy *= second;
+    return copy;
+}
+
+template <typename Field>
+Polynomial<Field> operator/(const Polynomial<Field> &first, const Polynomial<Field> &second) {
+    Polynomial<Field> copy = first;
+    copy /= second;
+    return copy;
+}
+
+template <typename Field>
+Polynomial<Field> operator%(const Polynomial<Field> &first, const Polynomial<Field> &second) {
+    Polynomial<Field> copy = first;
+    copy %= second;
+    return copy;
+}
+
+template <typename Field>
+bool operator==(const Polynomial<Field> &twin1, const Polynomial<Field> &twin2) {
+    return twin1.coefficient == twin2.coefficient;
+}
+
+template <typename Field>
+bool operator!=(const Polynomial<Field> &twin1, const Polynomial<Field> &twin2) {
+    return !(twin1 == twin2);
+}
+
+template <size_t N, typename Field = Rational>
+class LUDecomposition;
+
 template <size_t N, size_t M, typename Field = Rational>
 class Matrix {
 private:
@@ -950,20 +1430,56 @@ public:
     Matrix<N, M, Field>& operator*=(const Matrix<A, B, Field> &mat) {
         static_assert(M == A && A == B);
         Matrix<N, M, Field> copy;
+        multiply_into(*this, mat, copy);
+        cell.swap(copy.cell);
+        return *this;
+    }
+
+    // result = first * second, written into result's existing storage; result must not alias the operands.
+    template<size_t A>
+    static void multiply_into(const Matrix<N, A, Field> &first, const Matrix<A, M, Field> &second, Matrix<N, M, Field> &result) {
         for (size_t i = 0; i < N; ++i) {
-            for (size_t j = 0; j < M; ++j) {
-                for (size_t r = 0; r < M; ++r) {
-                    copy[i][j] += cell[i][r] * mat[r][j];
+            std::vector<Field> &row = result[i];
+            std::fill(row.begin(), row.end(), Field(0));
+            for (size_t r = 0; r < A; ++r) {
+                const Field &factor = first[i][r];
+                if (factor == Field(0))
+                    continue;
+                const std::vector<Field> &other_row = second[r];
+                for (size_t j = 0; j < M; ++j) {
+                    row[j] += factor * other_row[j];
                 }
             }
         }
+    }
 
+    static Matrix<N, M, Field> identity() {
+        static_assert(N == M);
+        Matrix<N, M, Field> result;
         for (size_t i = 0; i < N; ++i) {
-            for (size_t j = 0; j < M; ++j) {
-                cell[i][j] = copy[i][j];
+            result[i][i] = Field(1);
+        }
+        return result;
+    }
+
+    // Binary exponentiation over three preallocated matrices, swapping storage instead of copying.
+    Matrix<N, M, Field> pow(uint64_t exponent) const {
+        static_assert(N == M);
+        Matrix<N, M, Field> result = identity();
+        Matrix<N, M, Field> base = *this;
+        Matrix<N, M, Field> buffer;
+        while (exponent > 0) {
+            if (exponent % 2 == 1) {
+                multiply_into(result, base, buffer);
+                result.cell.swap(buffer.cell);
+            }
+            exponent /= 2;
+            if (exponent > 0) {
+                multiply_into(base, base, buffer);
+                base.cell.swap(buffer.cell);
             }
         }
-        return *this;
+        return result;
     }
 
     template<size_t A, size_t B>
@@ -1000,6 +1516,8 @@ public:
     }
 
     size_t rank() const {
+        if constexpr (N == M)
+            return lu().rank();
         Matrix<N, M, Field> copy = *this;
         copy.gauss();
         size_t rank = 0;
@@ -1016,19 +1534,7 @@ public:
 
     Matrix<N, M, Field>& invert() {
         static_assert(N == M);
-        Matrix<N, 2 * M, Field> result;
-        for (size_t i = 0; i < N; ++i) {
-            for (size_t j = 0; j < M; ++j) {
-                result[i][j] = cell[i][j];
-            }
-            result[i][M + i] = Field(1);
-        }
-        result.gauss();
-        for (size_t i = 0; i < N; ++i) {
-            for (size_t j = 0; j < M; ++j) {
-                cell[i][j] = result[i][j + M];
-            }
-        }
+        *this = lu().inverse();
         return *this;
     }
 
@@ -1039,20 +1545,17 @@ public:
     }
 
     std::pair<Matrix<N, M, Field>&, Field> gauss() {
-        bool even = true;
         size_t j = 0;
         Field ratio(Field(1));
         Field factor(Field(1));
         for (size_t i = 0; i < std::min(N, M); ++i) {
             j = i;
-            even = true;
             while (j < N && cell[j][i] == Field(0)) {
                 ++j;
-                even = !even;
             }
             if (j == N)
                 continue;
-            if (!even) {
+            if (j != i) {
                 ratio = -ratio;
                 std::swap(cell[i], cell[j]);
             }
@@ -1085,8 +1588,194 @@ public:
 
     Field det() {
         static_assert(N == M);
-        Matrix copy = *this;
-        return copy.gauss().second;
+        return lu().det();
+    }
+
+    LUDecomposition<N, Field> lu() const;
+
+    std::vector<Field> apply(const std::vector<Field> &vec) const {
+        std::vector<Field> result(N, Field(0));
+        for (size_t i = 0; i < N; ++i) {
+            for (size_t j = 0; j < M; ++j) {
+                result[i] += cell[i][j] * vec[j];
+            }
+        }
+        return result;
+    }
+
+    // det(xI - A) through reduction to upper Hessenberg form, O(N^3).
+    Polynomial<Field> charpoly() const {
+        static_assert(N == M);
+        Matrix<N, M, Field> hessenberg = *this;
+        for (size_t j = 0; j + 2 < N; ++j) {
+            size_t i = j + 1;
+            while (i < N && hessenberg[i][j] == Field(0))
+                ++i;
+            if (i == N)
+                continue;
+            if (i != j + 1) {
+                std::swap(hessenberg[i], hessenberg[j + 1]);
+                for (size_t r = 0; r < N; ++r) {
+                    std::swap(hessenberg[r][i], hessenberg[r][j + 1]);
+                }
+            }
+            Field pivot_inverse = Field(1) / hessenberg[j + 1][j];
+            for (i = j + 2; i < N; ++i) {
+                Field factor = hessenberg[i][j] * pivot_inverse;
+                if (factor == Field(0))
+                    continue;
+                for (size_t r = j; r < N; ++r) {
+                    hessenberg[i][r] -= factor * hessenberg[j + 1][r];
+                }
+                for (size_t r = 0; r < N; ++r) {
+                    hessenberg[r][j + 1] += factor * hessenberg[r][i];
+                }
+            }
+        }
+
+        std::vector<Polynomial<Field>> prefix(N + 1);
+        prefix[0] = Polynomial<Field>(Field(1));
+        for (size_t k = 1; k <= N; ++k) {
+            prefix[k] = Polynomial<Field>(std::vector<Field>{-hessenberg[k - 1][k - 1], Field(1)}) * prefix[k - 1];
+            Field product(1);
+            for (size_t i = k - 1; i-- > 0;) {
+                product *= hessenberg[i + 1][i];
+                if (product == Field(0))
+                    break;
+                Polynomial<Field> term = prefix[i];
+                prefix[k] -= term.scale(product * hessenberg[i][k - 1]);
+            }
+        }
+        return prefix[N];
+    }
+
+    // det(xI - A) by Berkowitz's algorithm, which uses no division and therefore works over rings.
+    Polynomial<Field> charpoly_division_free() const {
+        static_assert(N == M);
+        if (N == 0)
+            return Polynomial<Field>(Field(1));
+        std::vector<Field> coefficients{Field(1), -cell[0][0]};
+        for (size_t r = 1; r < N; ++r) {
+            std::vector<Field> column(r + 2, Field(0));
+            column[0] = Field(1);
+            column[1] = -cell[r][r];
+            std::vector<Field> power(r, Field(0));
+            for (size_t i = 0; i < r; ++i) {
+                power[i] = cell[i][r];
+            }
+            for (size_t k = 2; k < r + 2; ++k) {
+                Field value(0);
+                for (size_t i = 0; i < r; ++i) {
+                    value += cell[r][i] * power[i];
+                }
+                column[k] = -value;
+                std::vector<Field> next(r, Field(0));
+                for (size_t i = 0; i < r; ++i) {
+                    for (size_t j = 0; j < r; ++j) {
+                        next[i] += cell[i][j] * power[j];
+                    }
+                }
+                power = std::move(next);
+            }
+            std::vector<Field> updated(r + 2, Field(0));
+            for (size_t i = 0; i < r + 2; ++i) {
+                for (size_t j = 0; j <= i && j < r + 1; ++j) {
+                    updated[i] += column[i - j] * coefficients[j];
+                }
+            }
+            coefficients = std::move(updated);
+        }
+        std::reverse(coefficients.begin(), coefficients.end());
+        return Polynomial<Field>(std::move(coefficients));
+    }
+
+    // A^k v without forming A^k: by Cayley-Hamilton A^k v = r(A) v for r = x^k mod charpoly,
+    // so the cost is one charpoly, O(log k) polynomial products modulo it and N matrix-vector products.
+    std::vector<Field> apply_power(uint64_t exponent, const std::vector<Field> &vec) const {
+        static_assert(N == M);
+        if (exponent <= N) {
+            std::vector<Field> result = vec;
+            for (uint64_t i = 0; i < exponent; ++i) {
+                result = apply(result);
+            }
+            return result;
+        }
+        Polynomial<Field> modulus = charpoly();
+        Polynomial<Field> remainder(Field(1));
+        Polynomial<Field> base(std::vector<Field>{Field(0), Field(1)});
+        while (exponent > 0) {
+            if (exponent % 2 == 1)
+                remainder = remainder * base % modulus;
+            exponent /= 2;
+            if (exponent > 0)
+                base = base * base % modulus;
+        }
+        std::vector<Field> result(N, Field(0));
+        for (int k = remainder.degree(); k >= 0; --k) {
+            result = apply(result);
+            for (size_t i = 0; i < N; ++i) {
+                result[i] += remainder[k] * vec[i];
+            }
+        }
+        return result;
+    }
+
+    bool annihilates(const Polynomial<Field> &poly, const std::vector<Field> &vec) const {
+        std::vector<Field> result(N, Field(0));
+        for (int k = poly.degree(); k >= 0; --k) {
+            result = apply(result);
+            for (size_t i = 0; i < N; ++i) {
+                result[i] += poly[k] * vec[i];
+            }
+        }
+        for (const auto &x : result) {
+            if (x != Field(0))
+                return false;
+        }
+        return true;
+    }
+
+    // Wiedemann's algorithm: lcm of minimal polynomials of random projections u^T A^i v.
+    // Monte Carlo, so over very small fields the result may still miss a factor; calling again
+    // with another seed draws fresh projections.
+    Polynomial<Field> minpoly(uint64_t seed = N) const {
+        static_assert(N == M);
+        std::mt19937_64 generator(seed);
+        Polynomial<Field> result(Field(1));
+        size_t stable_rounds = 0;
+        while (stable_rounds < 3 && result.degree() < static_cast<int>(N)) {
+            std::vector<Field> projection(N, Field(0));
+            std::vector<Field> vec(N, Field(0));
+            for (size_t i = 0; i < N; ++i) {
+                projection[i] = Field(static_cast<long long>(generator() >> 2));
+                vec[i] = Field(static_cast<long long>(generator() >> 2));
+            }
+            std::vector<Field> sequence;
+            for (size_t k = 0; k < 2 * N; ++k) {
+                Field value(0);
+                for (size_t i = 0; i < N; ++i) {
+                    value += projection[i] * vec[i];
+                }
+                sequence.push_back(value);
+                vec = apply(vec);
+            }
+            Polynomial<Field> joined = result.lcm(Polynomial<Field>::berlekamp_massey(sequence));
+            stable_rounds = (joined == result && annihilates(joined, projection) ? stable_rounds + 1 : 0);
+            result = joined;
+        }
+        return result;
+    }
+
+    // det(A - x I) for every x in points: one charpoly and one multipoint evaluation.
+    std::vector<Field> shifted_det(const std::vector<Field> &points) const {
+        static_assert(N == M);
+        std::vector<Field> values = charpoly().evaluate(points);
+        if (N % 2 == 1) {
+            for (auto &value : values) {
+                value = -value;
+            }
+        }
+        return values;
     }
 };
 
@@ -1131,3 +1820,422 @@ bool operator!=(const Matrix<A, B, Field> &twin1, const Matrix<C, D, Field> &twi
 
 template<size_t N, typename Field = Rational>
 using SquareMatrix = Matrix<N, N, Field>;
+
+template <size_t N, typename Field>
+class LUDecomposition {
+private:
+    // Unit lower triangular L below the diagonal, row echelon U on and above it, PA = LU.
+    SquareMatrix<N, Field> lu;
+    std::vector<size_t> permutation;
+    size_t matrix_rank = 0;
+    bool even = true;
+
+    void require_invertible() const {
+        if (matrix_rank != N)
+            throw std::domain_error("Error: matrix is singular");
+    }
+
+    template <size_t K>
+    void substitute(Matrix<N, K, Field> &rhs) const {
+        for (size_t i = 0; i < N; ++i) {
+            for (size_t j = 0; j < i; ++j) {
+                if (lu[i][j] == Field(0))
+                    continue;
+                for (size_t r = 0; r < K; ++r) {
+                    rhs[i][r] -= lu[i][j] * rhs[j][r];
+                }
+            }
+        }
+        for (size_t i = N; i-- > 0;) {
+            for (size_t j = i + 1; j < N; ++j) {
+                if (lu[i][j] == Field(0))
+                    continue;
+                for (size_t r = 0; r < K; ++r) {
+                    rhs[i][r] -= lu[i][j] * rhs[j][r];
+                }
+            }
+            Field factor = Field(1) / lu[i][i];
+            for (size_t r = 0; r < K; ++r) {
+                rhs[i][r] *= factor;
+            }
+        }
+    }
+
+public:
+    explicit LUDecomposition(const SquareMatrix<N, Field> &mat) : lu(mat), permutation(N) {
+        for (size_t i = 0; i < N; ++i) {
+            permutation[i] = i;
+        }
+        for (size_t column = 0; column < N && matrix_rank < N; ++column) {
+            size_t pivot = matrix_rank;
+            while (pivot < N && lu[pivot][column] == Field(0))
+                ++pivot;
+            if (pivot == N)
+                continue;
+            if (pivot != matrix_rank) {
+                std::swap(lu[pivot], lu[matrix_rank]);
+                std::swap(permutation[pivot], permutation[matrix_rank]);
+                even = !even;
+            }
+            Field pivot_inverse = Field(1) / lu[matrix_rank][column];
+            for (size_t i = matrix_rank + 1; i < N; ++i) {
+                Field factor = lu[i][column] * pivot_inverse;
+                lu[i][column] = Field(0);
+                if (factor == Field(0))
+                    continue;
+                for (size_t r = column + 1; r < N; ++r) {
+                    lu[i][r] -= factor * lu[matrix_rank][r];
+                }
+                lu[i][matrix_rank] = factor;
+            }
+            ++matrix_rank;
+        }
+    }
+
+    size_t rank() const {
+        return matrix_rank;
+    }
+
+    Field det() const {
+        if (matrix_rank != N)
+            return Field(0);
+        Field result = even ? Field(1) : -Field(1);
+        for (size_t i = 0; i < N; ++i) {
+            result *= lu[i][i];
+        }
+        return result;
+    }
+
+    std::vector<Field> solve(const std::vector<Field> &vec) const {
+        require_invertible();
+        Matrix<N, 1, Field> rhs;
+        for (size_t i = 0; i < N; ++i) {
+            rhs[i][0] = vec[permutation[i]];
+        }
+        substitute(rhs);
+        std::vector<Field> result(N, Field(0));
+        for (size_t i = 0; i < N; ++i) {
+            result[i] = rhs[i][0];
+        }
+        return result;
+    }
+
+    template <size_t K>
+    Matrix<N, K, Field> solve(const Matrix<N, K, Field> &mat) const {
+        require_invertible();
+        Matrix<N, K, Field> rhs;
+        for (size_t i = 0; i < N; ++i) {
+            rhs[i] = mat[permutation[i]];
+        }
+        substitute(rhs);
+        return rhs;
+    }
+
+    SquareMatrix<N, Field> inverse() const {
+        SquareMatrix<N, Field> identity;
+        for (size_t i = 0; i < N; ++i) {
+            identity[i][i] = Field(1);
+        }
+        return solve(identity);
+    }
+};
+
+template <size_t N, size_t M, typename Field>
+LUDecomposition<N, Field> Matrix<N, M, Field>::lu() const {
+    static_assert(N == M);
+    return LUDecomposition<N, Field>(*this);
+}
+
+template <size_t N, typename Float>
+class FloatingLUDecomposition {
+private:
+    // Row-major N x N storage, L below the diagonal (unit diagonal implied), U on and above it.
+    std::vector<Float> lu;
+    std::vector<size_t> permutation;
+    Float norm = Float(0);
+    size_t matrix_rank = 0;
+    bool even = true;
+    static const size_t block_size = 48;
+
+    Float &at(size_t i, size_t j) {
+        return lu[i * N + j];
+    }
+
+    const Float &at(size_t i, size_t j) const {
+        return lu[i * N + j];
+    }
+
+    void swap_rows(size_t first, size_t second) {
+        if (first == second)
+            return;
+        std::swap_ranges(lu.begin() + first * N, lu.begin() + (first + 1) * N, lu.begin() + second * N);
+        std::swap(permutation[first], permutation[second]);
+        even = !even;
+    }
+
+    // Unblocked elimination with partial pivoting on columns [begin, end), updating only those columns.
+    void factor_panel(size_t begin, size_t end) {
+        for (size_t k = begin; k < end; ++k) {
+            size_t pivot = k;
+            for (size_t i = k + 1; i < N; ++i) {
+                if (std::abs(at(i, k)) > std::abs(at(pivot, k)))
+                    pivot = i;
+            }
+            swap_rows(k, pivot);
+            if (at(k, k) == Float(0))
+                continue;
+            Float pivot_inverse = Float(1) / at(k, k);
+            for (size_t i = k + 1; i < N; ++i) {
+                Float factor = (at(i, k) *= pivot_inverse);
+                if (factor == Float(0))
+                    continue;
+                Float *row = &at(i, 0);
+                const Float *pivot_row = &at(k, 0);
+                for (size_t j = k + 1; j < end; ++j) {
+                    row[j] -= factor * pivot_row[j];
+                }
+            }
+        }
+    }
+
+    // Partial pivoting does not move past a column without a pivot, so the diagonal of U need not
+    // reveal the rank. rank(A) = rank(U), which row-echelon elimination on a copy of U finds by
+    // skipping columns whose largest remaining entry is within N * eps * ||A||_1 of zero; for an
+    // invertible U this costs O(N^2), since every column pivots in place with nothing below it.
+    size_t compute_rank() const {
+        Float tolerance = norm * static_cast<Float>(N) * std::numeric_limits<Float>::epsilon();
+        std::vector<Float> echelon(N * N, Float(0));
+        for (size_t i = 0; i < N; ++i) {
+            std::copy(lu.begin() + i * N + i, lu.begin() + (i + 1) * N, echelon.begin() + i * N + i);
+        }
+        size_t row = 0;
+        for (size_t column = 0; column < N && row < N; ++column) {
+            size_t pivot = row;
+            for (size_t i = row + 1; i < N; ++i) {
+                if (std::abs(echelon[i * N + column]) > std::abs(echelon[pivot * N + column]))
+                    pivot = i;
+            }
+            if (std::abs(echelon[pivot * N + column]) <= tolerance)
+                continue;
+            if (pivot != row)
+                std::swap_ranges(echelon.begin() + pivot * N, echelon.begin() + (pivot + 1) * N, echelon.begin() + row * N);
+            for (size_t i = row + 1; i < N; ++i) {
+                Float factor = echelon[i * N + column] / echelon[row * N + column];
+                if (factor == Float(0))
+                    continue;
+                for (size_t j = column; j < N; ++j) {
+                    echelon[i * N + j] -= factor * echelon[row * N + j];
+                }
+            }
+            ++row;
+        }
+        return row;
+    }
+
+    void require_invertible() const {
+        if (matrix_rank != N)
+            throw std::domain_error("Error: matrix is singular");
+    }
+
+    void substitute(std::vector<Float> &vec) const {
+        for (size_t i = 0; i < N; ++i) {
+            const Float *row = &at(i, 0);
+            for (size_t j = 0; j < i; ++j) {
+                vec[i] -= row[j] * vec[j];
+            }
+        }
+        for (size_t i = N; i-- > 0;) {
+            const Float *row = &at(i, 0);
+            for (size_t j = i + 1; j < N; ++j) {
+                vec[i] -= row[j] * vec[j];
+            }
+            vec[i] /= row[i];
+        }
+    }
+
+    void substitute_transposed(std::vector<Float> &vec) const {
+        for (size_t i = 0; i < N; ++i) {
+            vec[i] /= at(i, i);
+            const Float *row = &at(i, 0);
+            for (size_t j = i + 1; j < N; ++j) {
+                vec[j] -= row[j] * vec[i];
+            }
+        }
+        for (size_t i = N; i-- > 0;) {
+            const Float *row = &at(i, 0);
+            for (size_t j = 0; j < i; ++j) {
+                vec[j] -= row[j] * vec[i];
+            }
+        }
+    }
+
+public:
+    // Right-looking blocked LU: factor a panel, solve for the U block row, then update the trailing matrix.
+    explicit FloatingLUDecomposition(const SquareMatrix<N, Float> &mat) : lu(N * N), permutation(N) {
+        for (size_t i = 0; i < N; ++i) {
+            std::copy(mat[i].begin(), mat[i].end(), lu.begin() + i * N);
+            permutation[i] = i;
+        }
+        for (size_t j = 0; j < N; ++j) {
+            Float column_norm = Float(0);
+            for (size_t i = 0; i < N; ++i) {
+                column_norm += std::abs(at(i, j));
+            }
+            norm = std::max(norm, column_norm);
+        }
+
+        for (size_t begin = 0; begin < N; begin += block_size) {
+            size_t end = std::min(N, begin + block_size);
+            factor_panel(begin, end);
+
+            for (size_t k = begin; k < end; ++k) {
+                Float *pivot_row = &at(k, 0);
+                for (size_t i = k + 1; i < end; ++i) {
+                    Float factor = at(i, k);
+                    if (factor == Float(0))
+                        continue;
+                    Float *row = &at(i, 0);
+                    for (size_t j = end; j < N; ++j) {
+                        row[j] -= factor * pivot_row[j];
+                    }
+                }
+            }
+
+            for (size_t i = end; i < N; ++i) {
+                Float *row = &at(i, 0);
+                for (size_t k = begin; k < end; ++k) {
+                    Float factor = row[k];
+                    if (factor == Float(0))
+                        continue;
+                    const Float *pivot_row = &at(k, 0);
+                    for (size_t j = end; j < N; ++j) {
+                        row[j] -= factor * pivot_row[j];
+                    }
+                }
+            }
+        }
+        matrix_rank = compute_rank();
+    }
+
+    size_t rank() const {
+        return matrix_rank;
+    }
+
+    Float det() const {
+        if (matrix_rank != N)
+            return Float(0);
+        Float result = even ? Float(1) : Float(-1);
+        for (size_t i = 0; i < N; ++i) {
+            result *= at(i, i);
+        }
+        return result;
+    }
+
+    std::vector<Float> solve(const std::vector<Float> &vec) const {
+        require_invertible();
+        std::vector<Float> result(N);
+        for (size_t i = 0; i < N; ++i) {
+            result[i] = vec[permutation[i]];
+        }
+        substitute(result);
+        return result;
+    }
+
+    template <size_t K>
+    Matrix<N, K, Float> solve(const Matrix<N, K, Float> &mat) const {
+        require_invertible();
+        Matrix<N, K, Float> rhs;
+        for (size_t i = 0; i < N; ++i) {
+            rhs[i] = mat[permutation[i]];
+        }
+        for (size_t i = 0; i < N; ++i) {
+            for (size_t j = 0; j < i; ++j) {
+                Float factor = at(i, j);
+                if (factor == Float(0))
+                    continue;
+                for (size_t r = 0; r < K; ++r) {
+                    rhs[i][r] -= factor * rhs[j][r];
+                }
+            }
+        }
+        for (size_t i = N; i-- > 0;) {
+            for (size_t j = i + 1; j < N; ++j) {
+                Float factor = at(i, j);
+                if (factor == Float(0))
+                    continue;
+                for (size_t r = 0; r < K; ++r) {
+                    rhs[i][r] -= factor * rhs[j][r];
+                }
+            }
+            Float factor = Float(1) / at(i, i);
+            for (size_t r = 0; r < K; ++r) {
+                rhs[i][r] *= factor;
+            }
+        }
+        return rhs;
+    }
+
+    SquareMatrix<N, Float> inverse() const {
+        SquareMatrix<N, Float> identity;
+        for (size_t i = 0; i < N; ++i) {
+            identity[i][i] = Float(1);
+        }
+        return solve(identity);
+    }
+
+    // 1-norm condition number, with ||A^-1||_1 estimated by Hager's method (a handful of O(N^2) solves).
+    Float condition_number() const {
+        if (matrix_rank != N)
+            return std::numeric_limits<Float>::infinity();
+        std::vector<Float> x(N, Float(1) / static_cast<Float>(N));
+        Float estimate = Float(0);
+        for (size_t iteration = 0; iteration < 5; ++iteration) {
+            std::vector<Float> y = solve(x);
+            Float y_norm = Float(0);
+            std::vector<Float> sign(N);
+            for (size_t i = 0; i < N; ++i) {
+                y_norm += std::abs(y[i]);
+                sign[i] = y[i] < Float(0) ? Float(-1) : Float(1);
+            }
+            if (iteration > 0 && y_norm <= estimate)
+                break;
+            estimate = y_norm;
+
+            substitute_transposed(sign);
+            std::vector<Float> z(N);
+            for (size_t i = 0; i < N; ++i) {
+                z[permutation[i]] = sign[i];
+            }
+            size_t largest = 0;
+            Float dot = Float(0);
+            for (size_t i = 0; i < N; ++i) {
+                dot += z[i] * x[i];
+                if (std::abs(z[i]) > std::abs(z[largest]))
+                    largest = i;
+            }
+            if (std::abs(z[largest]) <= dot)
+                break;
+            std::fill(x.begin(), x.end(), Float(0));
+            x[largest] = Float(1);
+        }
+        return norm * estimate;
+    }
+};
+
+template <size_t N>
+class LUDecomposition<N, float> : public FloatingLUDecomposition<N, float> {
+public:
+    using FloatingLUDecomposition<N, float>::FloatingLUDecomposition;
+};
+
+template <size_t N>
+class LUDecomposition<N, double> : public FloatingLUDecomposition<N, double> {
+public:
+    using FloatingLUDecomposition<N, double>::FloatingLUDecomposition;
+};
+
+template <size_t N>
+class LUDecomposition<N, long double> : public FloatingLUDecomposition<N, long double> {
+public:
+    using FloatingLUDecomposition<N, long double>::FloatingLUDecomposition;
+};
@@ -0,0 +1,109 @@
+// g++ -std=c++17 -O2 -I.. concurrent_list_benchmark.cpp -o concurrent_list_benchmark -lpthread
+// ./concurrent_list_benchmark [threads] [read %] [insert %] [erase %] [key range] [operations per thread]
+#include "../list_with_stack_allocator.h"
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct BenchmarkOptions {
+    size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    unsigned read_percent = 80;
+    unsigned insert_percent = 10;
+    unsigned erase_percent = 10;
+    int key_range = 1024;
+    size_t operations_per_thread = 200000;
+};
+
+// List<int> kept sorted and duplicate-free under one mutex, so it answers the same queries as
+// ConcurrentList<int>.
+class LockedList {
+private:
+    List<int> list;
+    std::mutex mutex;
+
+    List<int>::iterator lower_bound(int value) {
+        auto it = list.begin();
+        while (it != list.end() && *it < value) ++it;
+        return it;
+    }
+
+public:
+    bool insert(int value) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = lower_bound(value);
+        if (it != list.end() && *it == value) return false;
+        list.insert(it, value);
+        return true;
+    }
+
+    bool erase(int value) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = lower_bound(value);
+        if (it == list.end() || *it != value) return false;
+        list.erase(it);
+        return true;
+    }
+
+    bool contains(int value) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = lower_bound(value);
+        return it != list.end() && *it == value;
+    }
+};
+
+// Fills half of the key range, then runs the operation mix on every thread at once and returns
+// the total throughput in operations per second.
+template <typename Set>
+double run(const BenchmarkOptions& options) {
+    Set set;
+    for (int key = 0; key < options.key_range; key += 2) set.insert(key);
+
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t t = 0; t < options.threads; ++t) {
+        threads.emplace_back([&, t]() {
+            std::mt19937 generator(static_cast<unsigned>(t + 1));
+            std::uniform_int_distribution<int> keys(0, options.key_range - 1);
+            std::uniform_int_distribution<unsigned> operations(0, 99);
+            for (size_t i = 0; i < options.operations_per_thread; ++i) {
+                int key = keys(generator);
+                unsigned operation = operations(generator);
+                if (operation < options.read_percent)
+                    set.contains(key);
+                else if (operation < options.read_percent + options.insert_percent)
+                    set.insert(key);
+                else
+                    set.erase(key);
+            }
+        });
+    }
+    for (std::thread& thread : threads) thread.join();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return static_cast<double>(options.threads * options.operations_per_thread) / elapsed.count();
+}
+
+int main(int argc, char** argv) {
+    BenchmarkOptions options;
+    if (argc > 1) options.threads = std::stoul(argv[1]);
+    if (argc > 2) options.read_percent = std::stoul(argv[2]);
+    if (argc > 3) options.insert_percent = std::stoul(argv[3]);
+    if (argc > 4) options.erase_percent = std::stoul(argv[4]);
+    if (argc > 5) options.key_range = std::stoi(argv[5]);
+    if (argc > 6) options.operations_per_thread = std::stoul(argv[6]);
+    if (options.threads == 0 || options.key_range <= 0 ||
+        options.read_percent + options.insert_percent + options.erase_percent != 100) {
+        std::cerr << "usage: " << argv[0] << " [threads] [read %] [insert %] [erase %] [key range] [operations per thread]\n"
+                  << "the three percentages must add up to 100\n";
+        return 1;
+    }
+
+    std::cout << options.threads << " threads, " << options.read_percent << "/" << options.insert_percent << "/"
+              << options.erase_percent << " read/insert/erase, keys in [0, " << options.key_range << "), "
+              << options.operations_per_thread << " operations per thread\n";
+    std::cout << "ConcurrentList:      " << run<ConcurrentList<int>>(options) << " ops/s\n";
+    std::cout << "List + std::mutex:   " << run<LockedList>(options) << " ops/s\n";
+}
@@ -2,32 +2,249 @@
 #include <cstdint>
 #include <iterator>
 #include <type_traits>
+#include <cstddef>
+#include <new>
+#include <algorithm>
+#include <memory_resource>
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <vector>
+#include <utility>
+
+
+    /*              StackStorageStatistics                */
+
+
+// Usage counters of a StackStorage<N, true>. The switch is part of the storage type, so
+// translation units that collect statistics and ones that do not can be linked together; without
+// it the base is empty and every record call compiles to nothing.
+template <bool Enabled>
+class StackStorageStatistics {
+protected:
+    void record_allocation(size_t, size_t) {}
+    void record_deallocation(size_t, size_t, bool) {}
+    void record_buffer_usage(size_t) {}
+    void record_heap_block(size_t) {}
+    void record_alignment_gap(size_t) {}
+};
+
+template <>
+class StackStorageStatistics<true> {
+public:
+    // Bucket i counts requests of [2^i, 2^(i+1)) bytes; the last bucket takes everything larger.
+    static constexpr size_t histogram_buckets = 16;
+
+    size_t allocations = 0;
+    size_t deallocations = 0;
+    size_t bytes_in_use = 0;
+    size_t peak_bytes_in_use = 0;
+    size_t buffer_high_water_mark = 0;
+    size_t heap_bytes = 0;
+    // Bytes added by rounding the live blocks up to their size class.
+    size_t padding_bytes = 0;
+    // Bytes skipped to align bump allocations, over the lifetime of the storage.
+    size_t alignment_gap_bytes = 0;
+    size_t unreclaimed_frees = 0;
+    size_t unreclaimed_bytes = 0;
+    size_t size_histogram[histogram_buckets] = {};
+
+protected:
+    void record_allocation(size_t n, size_t padding) {
+        ++allocations;
+        bytes_in_use += n;
+        padding_bytes += padding;
+        peak_bytes_in_use = std::max(peak_bytes_in_use, bytes_in_use);
+        size_t bucket = 0;
+        while (bucket + 1 < histogram_buckets && (n >> (bucket + 1)) != 0) ++bucket;
+        ++size_histogram[bucket];
+    }
+
+    void record_deallocation(size_t n, size_t padding, bool reclaimed) {
+        ++deallocations;
+        bytes_in_use -= n;
+        padding_bytes -= padding;
+        if (!reclaimed) {
+            ++unreclaimed_frees;
+            unreclaimed_bytes += n;
+        }
+    }
+
+    void record_buffer_usage(size_t used) { buffer_high_water_mark = std::max(buffer_high_water_mark, used); }
+    void record_heap_block(size_t n) { heap_bytes += n; }
+    void record_alignment_gap(size_t gap) { alignment_gap_bytes += gap; }
+};
+
+
+    /*              ArenaBlocks                */
+
+
+// Block layout shared by StackStorage and ConcurrentStackStorage. Small blocks (up to
+// size_classes granules with at most granule alignment) are rounded up to a whole number of
+// granules, so a freed block can serve any later request of its size class; freed ones are kept
+// in intrusive per-size-class free lists.
+class ArenaBlocks {
+public:
+    static constexpr size_t granule = alignof(std::max_align_t);
+    static constexpr size_t size_classes = 16;
+
+    static char* align_up(char* pointer, const size_t alignof_t) {
+        return pointer + (alignof_t - reinterpret_cast<uintptr_t>(pointer) % alignof_t) % alignof_t;
+    }
+
+    static bool fits(char* begin, char* end, size_t n, const size_t alignof_t) {
+        uintptr_t start = reinterpret_cast<uintptr_t>(begin) + (alignof_t - reinterpret_cast<uintptr_t>(begin) % alignof_t) % alignof_t;
+        return begin != nullptr && start <= reinterpret_cast<uintptr_t>(end) && n <= reinterpret_cast<uintptr_t>(end) - start;
+    }
+
+    // size_classes for blocks served outside the size classes.
+    static size_t size_class(size_t n, const size_t alignof_t) {
+        if (n == 0 || n > size_classes * granule || alignof_t > granule) return size_classes;
+        return (n + granule - 1) / granule - 1;
+    }
+
+    static size_t class_bytes(size_t size_class_index) { return (size_class_index + 1) * granule; }
+
+    class FreeLists {
+    private:
+        struct FreeBlock {
+            FreeBlock* next;
+        };
+
+        FreeBlock* heads[size_classes] = {};
+        size_t lengths[size_classes] = {};
+
+    public:
+        size_t length(size_t size_class_index) const { return lengths[size_class_index]; }
+
+        char* pop(size_t size_class_index) {
+            FreeBlock* block = heads[size_class_index];
+            if (block == nullptr) return nullptr;
+            heads[size_class_index] = block->next;
+            --lengths[size_class_index];
+            return reinterpret_cast<char*>(block);
+        }
+
+        void push(size_t size_class_index, char* pointer) {
+            heads[size_class_index] = new (pointer) FreeBlock{heads[size_class_index]};
+            ++lengths[size_class_index];
+        }
+
+        // Moves up to count blocks from the front of one list onto the same list of other.
+        size_t transfer(size_t size_class_index, FreeLists& other, size_t count) {
+            FreeBlock* first = heads[size_class_index];
+            if (first == nullptr || count == 0) return 0;
+            FreeBlock* last = first;
+            size_t moved = 1;
+            while (moved < count && last->next != nullptr) {
+                last = last->next;
+                ++moved;
+            }
+            heads[size_class_index] = last->next;
+            lengths[size_class_index] -= moved;
+            last->next = other.heads[size_class_index];
+            other.heads[size_class_index] = first;
+            other.lengths[size_class_index] += moved;
+            return moved;
+        }
+    };
+};
 
 
     /*              StackStorage                */
 
 
-template <size_t N>
-class StackStorage {
+// Bump allocator over an inline buffer that spills into a chain of heap blocks, each twice as
+// large as the one before, once the buffer is exhausted. Small blocks are laid out as described
+// in ArenaBlocks, and when freed out of order they go to a per-size-class free list that the
+// next allocation of that class pops in O(1).
+template <size_t N, bool CollectStatistics = false>
+class StackStorage : public StackStorageStatistics<CollectStatistics>, private ArenaBlocks {
 private:
-    char first_p[N];
+    using Statistics = StackStorageStatistics<CollectStatistics>;
+
+    struct alignas(std::max_align_t) HeapBlock {
+        HeapBlock* previous;
+    };
+
+    alignas(std::max_align_t) char first_p[N];
     char* last_p{first_p};
+    FreeLists free_lists;
+    HeapBlock* heap_blocks = nullptr;
+    char* heap_p = nullptr;
+    char* heap_end = nullptr;
+    size_t heap_block_size = N;
+
+    char* heap_bump(size_t n, const size_t alignof_t) {
+        if (!fits(heap_p, heap_end, n, alignof_t)) {
+            heap_block_size = std::max(2 * heap_block_size, n + alignof_t);
+            this->record_heap_block(heap_block_size);
+            HeapBlock* block = static_cast<HeapBlock*>(::operator new(sizeof(HeapBlock) + heap_block_size));
+            block->previous = heap_blocks;
+            heap_blocks = block;
+            heap_p = reinterpret_cast<char*>(block + 1);
+            heap_end = heap_p + heap_block_size;
+        }
+        char* result = align_up(heap_p, alignof_t);
+        this->record_alignment_gap(static_cast<size_t>(result - heap_p));
+        heap_p = result + n;
+        return result;
+    }
+
+    char* bump(size_t n, const size_t alignof_t) {
+        if (!fits(last_p, first_p + N, n, alignof_t)) return heap_bump(n, alignof_t);
+        char* result = align_up(last_p, alignof_t);
+        this->record_alignment_gap(static_cast<size_t>(result - last_p));
+        last_p = result + n;
+        this->record_buffer_usage(static_cast<size_t>(last_p - first_p));
+        return result;
+    }
 
 public:
     StackStorage() = default;
     StackStorage(const StackStorage&) = delete;
     StackStorage& operator=(const StackStorage&) = delete;
 
+    ~StackStorage() {
+        while (heap_blocks != nullptr) {
+            HeapBlock* previous = heap_blocks->previous;
+            ::operator delete(heap_blocks);
+            heap_blocks = previous;
+        }
+    }
+
+    const Statistics& statistics() const { return *this; }
+
     char* allocate(size_t n, const size_t alignof_t) {
-        n += alignof_t - ((reinterpret_cast<uintptr_t>(last_p) + n) % alignof_t);
-        char* last_p_copy = last_p;
-        last_p += n;
-        return last_p_copy;
+        size_t size_class_index = size_class(n, alignof_t);
+        if (size_class_index == size_classes) {
+            this->record_allocation(n, 0);
+            return bump(n, alignof_t);
+        }
+
+        this->record_allocation(n, class_bytes(size_class_index) - n);
+        char* block = free_lists.pop(size_class_index);
+        if (block != nullptr) return block;
+        return bump(class_bytes(size_class_index), granule);
     }
 
     void deallocate(char* pointer, size_t n, const size_t alignof_t) {
-        n += alignof_t - ((reinterpret_cast<uintptr_t>(last_p) + n) % alignof_t);
-        if (pointer + n == last_p) last_p = pointer;
+        size_t requested = n;
+        size_t size_class_index = size_class(n, alignof_t);
+        if (size_class_index != size_classes) n = class_bytes(size_class_index);
+
+        bool reclaimed = true;
+        if (pointer + n == last_p) {
+            last_p = pointer;
+        } else if (pointer + n == heap_p) {
+            heap_p = pointer;
+        } else if (size_class_index != size_classes) {
+            free_lists.push(size_class_index, pointer);
+        } else {
+            reclaimed = false;
+        }
+        this->record_deallocation(requested, n - requested, reclaimed);
     }
 };
 
@@ -35,22 +252,23 @@ public:
     /*              StackAllocator                */
 
 
-template <class T, size_t N>
+template <class T, size_t N, bool CollectStatistics = false>
 class StackAllocator {
 private:
-    template <class U, size_t M> friend class StackAllocator;
-    StackStorage<N>* storage {};
+    template <class U, size_t M, bool S> friend class StackAllocator;
+    StackStorage<N, CollectStatistics>* storage {};
 
 public:
     using value_type = T;
 
-    template <class U> struct rebind { using other = StackAllocator<U, N>; };
+    template <class U> struct rebind { using other = StackAllocator<U, N, CollectStatistics>; };
 
     StackAllocator() = default;
-    StackAllocator(StackStorage<N>& other_storage): storage(&other_storage) {}
+    StackAllocator(StackStorage<N, CollectStatistics>& other_storage): storage(&other_storage) {}
+    StackAllocator(const StackAllocator&) = default;
 
     template <class U>
-    StackAllocator(StackAllocator<U, N> const& other): storage(other.storage) { storage->allocate(1, alignof(T)); }
+    StackAllocator(StackAllocator<U, N, CollectStatistics> const& other): storage(other.storage) {}
 
     StackAllocator& operator=(StackAllocator const& other_allocator) {
         storage = other_allocator.storage;
@@ -62,17 +280,300 @@ public:
         storage->deallocate(static_cast<char*>(static_cast<void*>(pointer)), n * sizeof(T), alignof(T));
     }
 
+    const StackStorage<N, CollectStatistics>& get_storage() const { return *storage; }
+
     template <class U, class ...A>
     void construct(U* const pointer, A&& ...args) { new (pointer) U(std::forward<A>(args)...); }
 
     template <class U>
     void destroy(U* const pointer) { pointer->~U(); }
 
+    template <class U, size_t M, bool S>
+    bool operator==(StackAllocator<U, M, S> const& other_alloc) const { return storage == other_alloc.storage; }
+
+    template <class U, size_t M, bool S>
+    bool operator!=(StackAllocator<U, M, S> const& other_alloc) const { return !(*this == other_alloc); }
+};
+
+
+    /*              ThreadSlots                */
+
+
+// Small index for the calling thread, taken on first use and handed back when the thread exits,
+// so tables indexed by it stay as large as the number of threads alive at once.
+class ThreadIndex {
+private:
+    struct Registry {
+        std::mutex mutex;
+        std::vector<size_t> free_indices;
+        size_t next = 0;
+    };
+
+    static Registry& registry() {
+        static Registry instance;
+        return instance;
+    }
+
+    struct Holder {
+        size_t index;
+
+        Holder() {
+            Registry& shared = registry();
+            std::lock_guard<std::mutex> lock(shared.mutex);
+            if (shared.free_indices.empty()) {
+                index = shared.next++;
+            } else {
+                index = shared.free_indices.back();
+                shared.free_indices.pop_back();
+            }
+        }
+
+        ~Holder() {
+            Registry& shared = registry();
+            std::lock_guard<std::mutex> lock(shared.mutex);
+            shared.free_indices.push_back(index);
+        }
+    };
+
+public:
+    static size_t get() {
+        static thread_local Holder holder;
+        return holder.index;
+    }
+};
+
+// One Slot per thread for a single owning object. The calling thread finds its slot at its
+// ThreadIndex; the table grows by appending blocks of slots with a compare-and-swap, so any
+// number of threads can use it and a lookup never waits. A slot outlives the thread that used
+// it and passes, with its contents, to the next thread given the same index.
+template <typename Slot>
+class ThreadSlots {
+private:
+    static constexpr size_t slots_per_block = 64;
+
+    struct Block {
+        Slot slots[slots_per_block];
+        std::atomic<Block*> next{nullptr};
+    };
+
+    Block first_block;
+
+public:
+    ThreadSlots() = default;
+    ThreadSlots(const ThreadSlots&) = delete;
+    ThreadSlots& operator=(const ThreadSlots&) = delete;
+
+    ~ThreadSlots() {
+        Block* block = first_block.next.load(std::memory_order_relaxed);
+        while (block != nullptr) {
+            Block* next = block->next.load(std::memory_order_relaxed);
+            delete block;
+            block = next;
+        }
+    }
+
+    Slot& local() {
+        size_t index = ThreadIndex::get();
+        Block* block = &first_block;
+        for (; index >= slots_per_block; index -= slots_per_block) {
+            Block* next = block->next.load(std::memory_order_acquire);
+            if (next == nullptr) {
+                Block* fresh = new Block();
+                if (block->next.compare_exchange_strong(next, fresh, std::memory_order_acq_rel))
+                    next = fresh;
+                else
+                    delete fresh;
+            }
+            block = next;
+        }
+        return block->slots[index];
+    }
+
+    template <typename Function>
+    void for_each(Function function) {
+        for (Block* block = &first_block; block != nullptr; block = block->next.load(std::memory_order_acquire)) {
+            for (auto& slot : block->slots) {
+                function(slot);
+            }
+        }
+    }
+};
+
+
+    /*              ConcurrentStackStorage                */
+
+
+// Thread-safe arena: each thread bumps inside its own region of this storage and refills it from
+// the shared buffer with a compare-and-swap on the pool offset, so the fast path takes no lock
+// and touches no shared cache line. Small blocks are laid out as described in ArenaBlocks;
+// freed ones, from any thread and in any order, go to the freeing thread's
+// size-class free lists, which spill half of an overlong list into a shared list under a mutex
+// and refill from it when empty, so blocks freed by one thread are reused by the others. A large
+// block is reclaimed only when it is the last one in the freeing thread's region. When the
+// buffer runs out, allocations fall back to the heap.
+template <size_t N>
+class ConcurrentStackStorage : private ArenaBlocks {
+private:
+    static constexpr size_t region_size = std::max<size_t>(256, std::min<size_t>(4096, N / 16));
+    static constexpr size_t free_list_limit = 64;
+
+    struct alignas(64) ThreadCache {
+        char* last_p = nullptr;
+        char* end_p = nullptr;
+        FreeLists free_lists;
+    };
+
+    alignas(std::max_align_t) char first_p[N];
+    std::atomic<size_t> pool_offset{0};
+    ThreadSlots<ThreadCache> caches;
+
+    std::mutex shared_mutex;
+    FreeLists shared_lists;
+    // Lengths of shared_lists, readable without the mutex.
+    std::atomic<size_t> shared_counts[size_classes] = {};
+
+    char* pool_allocate(size_t n, const size_t alignof_t) {
+        size_t offset = pool_offset.load(std::memory_order_relaxed);
+        while (true) {
+            size_t start = static_cast<size_t>(align_up(first_p + offset, alignof_t) - first_p);
+            if (start > N || n > N - start) return nullptr;
+            if (pool_offset.compare_exchange_weak(offset, start + n, std::memory_order_relaxed)) return first_p + start;
+        }
+    }
+
+    bool owns(const char* pointer) const {
+        return reinterpret_cast<uintptr_t>(pointer) - reinterpret_cast<uintptr_t>(first_p) < N;
+    }
+
+    char* region_allocate(ThreadCache& cache, size_t n, const size_t alignof_t) {
+        if (fits(cache.last_p, cache.end_p, n, alignof_t)) {
+            char* result = align_up(cache.last_p, alignof_t);
+            cache.last_p = result + n;
+            return result;
+        }
+        if (n + alignof_t > region_size / 2)
+            return pool_allocate(n, alignof_t);
+
+        char* new_region = pool_allocate(region_size, alignof(std::max_align_t));
+        if (new_region == nullptr) return nullptr;
+        cache.end_p = new_region + region_size;
+        char* result = align_up(new_region, alignof_t);
+        cache.last_p = result + n;
+        return result;
+    }
+
+    void spill(ThreadCache& cache, size_t size_class_index) {
+        std::lock_guard<std::mutex> lock(shared_mutex);
+        size_t moved = cache.free_lists.transfer(size_class_index, shared_lists, free_list_limit / 2);
+        shared_counts[size_class_index].fetch_add(moved, std::memory_order_relaxed);
+    }
+
+    void refill(ThreadCache& cache, size_t size_class_index) {
+        std::lock_guard<std::mutex> lock(shared_mutex);
+        size_t moved = shared_lists.transfer(size_class_index, cache.free_lists, free_list_limit / 2);
+        shared_counts[size_class_index].fetch_sub(moved, std::memory_order_relaxed);
+    }
+
+public:
+    ConcurrentStackStorage() = default;
+    ConcurrentStackStorage(const ConcurrentStackStorage&) = delete;
+    ConcurrentStackStorage& operator=(const ConcurrentStackStorage&) = delete;
+
+    char* allocate(size_t n, const size_t alignof_t) {
+        ThreadCache& cache = caches.local();
+        size_t size_class_index = size_class(n, alignof_t);
+        char* result = nullptr;
+        if (size_class_index != size_classes) {
+            if (cache.free_lists.length(size_class_index) == 0 && shared_counts[size_class_index].load(std::memory_order_relaxed) != 0)
+                refill(cache, size_class_index);
+            char* block = cache.free_lists.pop(size_class_index);
+            if (block != nullptr) return block;
+            n = class_bytes(size_class_index);
+            result = region_allocate(cache, n, granule);
+        } else {
+            result = region_allocate(cache, n, alignof_t);
+        }
+        if (result == nullptr)
+            result = static_cast<char*>(::operator new(n, std::align_val_t(alignof_t)));
+        return result;
+    }
+
+    void deallocate(char* pointer, size_t n, const size_t alignof_t) {
+        if (!owns(pointer)) {
+            ::operator delete(pointer, std::align_val_t(alignof_t));
+            return;
+        }
+        ThreadCache& cache = caches.local();
+        size_t size_class_index = size_class(n, alignof_t);
+        if (size_class_index != size_classes) n = class_bytes(size_class_index);
+
+        if (pointer + n == cache.last_p) {
+            cache.last_p = pointer;
+        } else if (size_class_index != size_classes) {
+            cache.free_lists.push(size_class_index, pointer);
+            if (cache.free_lists.length(size_class_index) > free_list_limit)
+                spill(cache, size_class_index);
+        }
+    }
+};
+
+
+    /*              ConcurrentStackAllocator                */
+
+
+template <class T, size_t N>
+class ConcurrentStackAllocator {
+private:
+    template <class U, size_t M> friend class ConcurrentStackAllocator;
+    ConcurrentStackStorage<N>* storage {};
+
+public:
+    using value_type = T;
+
+    template <class U> struct rebind { using other = ConcurrentStackAllocator<U, N>; };
+
+    ConcurrentStackAllocator() = default;
+    ConcurrentStackAllocator(ConcurrentStackStorage<N>& other_storage): storage(&other_storage) {}
+
+    template <class U>
+    ConcurrentStackAllocator(ConcurrentStackAllocator<U, N> const& other): storage(other.storage) {}
+
+    T* allocate(size_t const n) { return static_cast<T*>(static_cast<void*>(storage->allocate(n * sizeof(T), alignof(T)))); }
+    void deallocate(T* const pointer, size_t const n) {
+        storage->deallocate(static_cast<char*>(static_cast<void*>(pointer)), n * sizeof(T), alignof(T));
+    }
+
     template <class U, size_t M>
-    bool operator==(StackAllocator<U, M> const& other_alloc) const { return storage == other_alloc.storage; }
+    bool operator==(ConcurrentStackAllocator<U, M> const& other_alloc) const { return storage == other_alloc.storage; }
 
     template <class U, size_t M>
-    bool operator!=(StackAllocator<U, M> const& other_alloc) const { return !(*this == other_alloc); }
+    bool operator!=(ConcurrentStackAllocator<U, M> const& other_alloc) const { return !(*this == other_alloc); }
+};
+
+
+    /*              StackMemoryResource                */
+
+
+// Exposes a StackStorage as a std::pmr::memory_resource, so one arena can back pmr containers,
+// Deque and List with a polymorphic_allocator regardless of the storage size N.
+template <size_t N, bool CollectStatistics = false>
+class StackMemoryResource : public std::pmr::memory_resource {
+private:
+    StackStorage<N, CollectStatistics>* storage;
+
+    void* do_allocate(size_t bytes, size_t alignment) override { return storage->allocate(bytes, alignment); }
+
+    void do_deallocate(void* pointer, size_t bytes, size_t alignment) override {
+        storage->deallocate(static_cast<char*>(pointer), bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        const StackMemoryResource* other_resource = dynamic_cast<const StackMemoryResource*>(&other);
+        return other_resource != nullptr && other_resource->storage == storage;
+    }
+
+public:
+    explicit StackMemoryResource(StackStorage<N, CollectStatistics>& given_storage): storage(&given_storage) {}
 };
 
 
@@ -82,31 +583,152 @@ public:
 template<typename T, typename Allocator = std::allocator<T>>
 class List {
 private:
-    struct Node {
+    // The sentinel carries only the links, so an empty List allocates nothing and moving one
+    // never allocates.
+    struct BaseNode {
+        BaseNode* prev;
+        BaseNode* next;
+    };
+
+    struct Node : BaseNode {
         T value;
-        Node* prev;
-        Node* next;
 
-        Node() = default;
-        Node(Node* prev = nullptr, Node* next = nullptr): value(T()), prev(prev), next(next) {}
-        explicit Node(const T& value, Node* prev, Node* next): value(value), prev(prev), next(next) {};
+        template <typename... Args>
+        explicit Node(BaseNode* prev, BaseNode* next, Args&&... args): BaseNode{prev, next}, value(std::forward<Args>(args)...) {}
     };
 
     using NodeAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<Node>;
 
-    Node* base_node;
+    BaseNode base{&base, &base};
     NodeAllocator node_alloc;
     size_t sz = 0;
 
-    void connect_nodes(Node* left, Node* right) {
+    static T& value_of(BaseNode* node) { return static_cast<Node*>(node)->value; }
+
+    void connect_nodes(BaseNode* left, BaseNode* right) {
         if (left != nullptr) left->next = right;
         if (right != nullptr) right->prev = left;
     }
 
-    Node* build_base_node() {
-        Node* new_head = static_cast<Node*>(std::allocator_traits<NodeAllocator>::allocate(node_alloc, 1));
-        connect_nodes(new_head, new_head);
-        return new_head;
+    template <typename... Args>
+    Node* create_node(BaseNode* prev, BaseNode* next, Args&&... args) {
+        Node* new_node = std::allocator_traits<NodeAllocator>::allocate(node_alloc, 1);
+        try {
+            std::allocator_traits<NodeAllocator>::construct(node_alloc, new_node, prev, next, std::forward<Args>(args)...);
+        } catch(...) {
+            std::allocator_traits<NodeAllocator>::deallocate(node_alloc, new_node, 1);
+            throw;
+        }
+        return new_node;
+    }
+
+    void destroy_node(BaseNode* node) {
+        Node* value_node = static_cast<Node*>(node);
+        std::allocator_traits<NodeAllocator>::destroy(node_alloc, value_node);
+        std::allocator_traits<NodeAllocator>::deallocate(node_alloc, value_node, 1);
+    }
+
+    // Takes over the nodes of other, which must use an equal allocator; this list must be empty.
+    void steal_nodes(List& other) {
+        if (other.sz == 0) return;
+        connect_nodes(&base, other.base.next);
+        connect_nodes(other.base.prev, &base);
+        sz = other.sz;
+        connect_nodes(&other.base, &other.base);
+        other.sz = 0;
+    }
+
+    // Detached run of nodes linked in both directions, not yet attached to the base node.
+    struct Chain {
+        BaseNode* head = nullptr;
+        BaseNode* tail = nullptr;
+        size_t size = 0;
+    };
+
+    template <typename... Args>
+    void append_new_node(Chain& chain, Args&&... args) {
+        Node* new_node = create_node(chain.tail, nullptr, std::forward<Args>(args)...);
+        if (chain.head == nullptr) chain.head = new_node;
+        connect_nodes(chain.tail, new_node);
+        chain.tail = new_node;
+        ++chain.size;
+    }
+
+    void destroy_chain(Chain& chain) {
+        while (chain.head != nullptr) {
+            BaseNode* next = (chain.head == chain.tail ? nullptr : chain.head->next);
+            destroy_node(chain.head);
+            chain.head = next;
+        }
+    }
+
+    template <typename InputIterator>
+    Chain build_chain(InputIterator first, InputIterator last) {
+        Chain chain;
+        try {
+            for (; first != last; ++first) {
+                append_new_node(chain, *first);
+            }
+        } catch(...) {
+            destroy_chain(chain);
+            throw;
+        }
+        return chain;
+    }
+
+    void link_chain(BaseNode* pos, const Chain& chain) {
+        if (chain.head == nullptr) return;
+        connect_nodes(pos->prev, chain.head);
+        connect_nodes(chain.tail, pos);
+        sz += chain.size;
+    }
+
+    // Moves [first, last) of some list in front of pos; sizes are adjusted by the caller.
+    static void transfer(BaseNode* pos, BaseNode* first, BaseNode* last) {
+        if (first == last || pos == last) return;
+        BaseNode* tail = last->prev;
+        first->prev->next = last;
+        last->prev = first->prev;
+        pos->prev->next = first;
+        first->prev = pos->prev;
+        tail->next = pos;
+        pos->prev = tail;
+    }
+
+    // Merges two nullptr-terminated chains linked through next only; ties keep the first chain first.
+    template <typename Compare>
+    static BaseNode* merge_chains(BaseNode* first, BaseNode* second, Compare& compare) {
+        BaseNode* head = nullptr;
+        BaseNode** tail = &head;
+        while (first != nullptr && second != nullptr) {
+            if (compare(value_of(second), value_of(first))) {
+                *tail = second;
+                second = second->next;
+            } else {
+                *tail = first;
+                first = first->next;
+            }
+            tail = &(*tail)->next;
+        }
+        *tail = (first != nullptr ? first : second);
+        return head;
+    }
+
+    BaseNode* detach_all() {
+        if (sz == 0) return nullptr;
+        BaseNode* head = base.next;
+        base.prev->next = nullptr;
+        connect_nodes(&base, &base);
+        return head;
+    }
+
+    void attach_all(BaseNode* head) {
+        BaseNode* prev = &base;
+        for (; head != nullptr; head = head->next) {
+            connect_nodes(prev, head);
+            prev = head;
+        }
+        connect_nodes(prev, &base);
     }
 
 
@@ -116,20 +738,20 @@ private:
     template<bool Const>
     class common_iterator {
     private:
-        Node* node;
+        BaseNode* node;
     public:
         using iterator_category = std::bidirectional_iterator_tag;
         using value_type = T;
-        using difference_type = int8_t;
+        using difference_type = std::ptrdiff_t;
         using pointer = typename std::conditional_t<Const, const T*, T*>;
         using reference = typename std::conditional_t<Const, const T&, T&>;
 
-        explicit common_iterator(const Node* node): node(const_cast<Node*>(node)) {};
+        explicit common_iterator(const BaseNode* node): node(const_cast<BaseNode*>(node)) {};
         common_iterator(): node(nullptr) {};
         common_iterator(const common_iterator<false>& iter): node(iter.node) {};
 
-        typename common_iterator::reference operator*() const { return node->value; }
-        typename common_iterator::pointer operator->() const { return &node->value; }
+        typename common_iterator::reference operator*() const { return value_of(node); }
+        typename common_iterator::pointer operator->() const { return &value_of(node); }
 
         bool operator==(const common_iterator& other_iter) const {
             if (other_iter.node == nullptr || node == nullptr) return false;
@@ -168,16 +790,16 @@ public:
     using reverse_iterator = std::reverse_iterator<iterator>;
     using const_reverse_iterator = std::reverse_iterator<const_iterator>;
 
-    iterator begin() { return iterator(base_node->next); }
-    const_iterator begin() const { return const_iterator(base_node->next); }
-    const_iterator cbegin() const { return const_iterator(base_node->next); }
+    iterator begin() { return iterator(base.next); }
+    const_iterator begin() const { return const_iterator(base.next); }
+    const_iterator cbegin() const { return const_iterator(base.next); }
     reverse_iterator rbegin() { return std::reverse_iterator(end()); }
     const_reverse_iterator rbegin() const { return std::reverse_iterator(cend()); }
     const_reverse_iterator crbegin() const { return std::reverse_iterator(cend());}
 
-    iterator end() { return iterator(base_node); }
-    const_iterator end() const { return const_iterator(base_node); }
-    const_iterator cend() const { return const_iterator(base_node); }
+    iterator end() { return iterator(&base); }
+    const_iterator end() const { return const_iterator(&base); }
+    const_iterator cend() const { return const_iterator(&base); }
     reverse_iterator rend() { return std::reverse_iterator(begin()); }
     const_reverse_iterator rend() const { return std::reverse_iterator(cbegin()); }
     const_reverse_iterator crend() const { return std::reverse_iterator(cbegin()); }
@@ -186,130 +808,996 @@ public:
     /*              List Methods                */
 
 
-    List(): node_alloc(Allocator()) {base_node = build_base_node();}
+    List(): node_alloc(Allocator()) {}
 
-    explicit List(const Allocator& allocator): node_alloc(allocator) { base_node = build_base_node(); }
+    explicit List(const Allocator& allocator): node_alloc(allocator) {}
 
     List(size_t given_size, const T& value, const Allocator& allocator = Allocator()): List(allocator) {
-        try {
-            for (size_t i = 0; i < given_size; ++i) {
-                insert_before_with_value(end(), T());
-            }
-        } catch(...) {
-            while (!empty()) {
-                pop_front();
-            }
-            throw;
-        }
+        assign(given_size, value);
     }
 
     explicit List(size_t given_size, const Allocator& allocator = Allocator()): List(allocator) {
         try {
             for (size_t i = 0; i < given_size; ++i) {
-                insert_before(end());
+                emplace_back();
             }
         } catch(...) {
-            while (!empty()) {
-                pop_front();
-            }
+            clear();
             throw;
         }
     }
 
     List(const List& other_list): List(std::allocator_traits<Allocator>::select_on_container_copy_construction(other_list.node_alloc)) {
-        try {
-            for (const auto& others_node: other_list) {
-                push_back(others_node);
-            }
-        } catch(...) {
-            while (!empty()) {
-                pop_front();
-            }
-            throw;
-        }
+        assign(other_list.begin(), other_list.end());
+    }
+
+    List(List&& other_list) noexcept: node_alloc(std::move(other_list.node_alloc)) {
+        steal_nodes(other_list);
     }
 
     List& operator=(const List& other_list) {
         if (this == &other_list) return *this;
 
-        size_t num_of_added = 0;
-        size_t copy_size = sz;
-        try {
-            const_iterator iter = other_list.begin();
-            while (iter++ != other_list.end()) {
-                push_back(*iter);
-                ++num_of_added;
-            }
-        } catch(...) {
-            for (size_t i = 0; i < num_of_added; ++i) {
-                pop_back();
-            }
-            throw;
-        }
-
-        for (size_t i = 0; i < copy_size; ++i) {
-            pop_front();
-        }
-
-        if (std::allocator_traits<NodeAllocator>::propagate_on_container_copy_assignment::value)
+        if constexpr (std::allocator_traits<NodeAllocator>::propagate_on_container_copy_assignment::value) {
+            if (node_alloc != other_list.node_alloc) clear();
             node_alloc = other_list.node_alloc;
-
+        }
+        assign(other_list.begin(), other_list.end());
         return *this;
     }
 
-    NodeAllocator get_allocator() { return node_alloc; }
+    List& operator=(List&& other_list) noexcept(std::allocator_traits<NodeAllocator>::propagate_on_container_move_assignment::value
+                                                || std::allocator_traits<NodeAllocator>::is_always_equal::value) {
+        if (this == &other_list) return *this;
 
-    void insert_before(const_iterator pos) {
-        Node* prev = (--pos).node;
-        Node* new_node = std::allocator_traits<NodeAllocator>::allocate(node_alloc, 1);
-        try {
-            std::allocator_traits<NodeAllocator>::construct(node_alloc, new_node, prev, (++pos).node);
-            connect_nodes(new_node, pos.node);
-            connect_nodes(prev, new_node);
-        } catch(...) {
-            std::allocator_traits<NodeAllocator>::deallocate(node_alloc, new_node, 1);
-            throw;
+        if constexpr (std::allocator_traits<NodeAllocator>::propagate_on_container_move_assignment::value) {
+            clear();
+            node_alloc = std::move(other_list.node_alloc);
+            steal_nodes(other_list);
+        } else {
+            if (node_alloc == other_list.node_alloc) {
+                clear();
+                steal_nodes(other_list);
+            } else {
+                assign(std::make_move_iterator(other_list.begin()), std::make_move_iterator(other_list.end()));
+            }
         }
-        ++sz;
+        return *this;
     }
 
-    void insert_before_with_value(const_iterator pos, const T& given_value) {
-        Node* prev = (--pos).node;
-        Node* new_node = std::allocator_traits<NodeAllocator>::allocate(node_alloc, 1);
-        try {
-            std::allocator_traits<NodeAllocator>::construct(node_alloc, new_node, given_value, prev, (++pos).node);
-            connect_nodes(new_node, pos.node);
-            connect_nodes(prev, new_node);
-        } catch(...) {
-            std::allocator_traits<NodeAllocator>::deallocate(node_alloc, new_node, 1);
-            throw;
-        }
+    NodeAllocator get_allocator() const { return node_alloc; }
+
+    template <typename... Args>
+    iterator emplace(const_iterator pos, Args&&... args) {
+        Node* new_node = create_node(pos.node->prev, pos.node, std::forward<Args>(args)...);
+        connect_nodes(pos.node->prev, new_node);
+        connect_nodes(new_node, pos.node);
         ++sz;
+        return iterator(new_node);
     }
 
+    template <typename... Args>
+    T& emplace_back(Args&&... args) { return *emplace(end(), std::forward<Args>(args)...); }
+
+    template <typename... Args>
+    T& emplace_front(Args&&... args) { return *emplace(begin(), std::forward<Args>(args)...); }
+
+    void insert_before(const_iterator pos) { emplace(pos); }
+    void insert_before_with_value(const_iterator pos, const T& given_value) { emplace(pos, given_value); }
+
     void erase(const_iterator pos) {
         if (pos != end()) {
-            Node* next = (++pos).node;
-            connect_nodes(std::prev(--pos).node, next);
-            std::allocator_traits<NodeAllocator>::destroy(node_alloc, pos.node);
-            std::allocator_traits<NodeAllocator>::deallocate(node_alloc, pos.node, 1);
+            connect_nodes(pos.node->prev, pos.node->next);
+            destroy_node(pos.node);
             --sz;
         }
     }
 
-    void push_back(const T& value) { insert_before_with_value(end(), value); }
-    void push_front(const T& value) { insert_before_with_value(begin(), value); }
+    void push_back(const T& value) { emplace(end(), value); }
+    void push_back(T&& value) { emplace(end(), std::move(value)); }
+    void push_front(const T& value) { emplace(begin(), value); }
+    void push_front(T&& value) { emplace(begin(), std::move(value)); }
     void pop_back() { erase(std::prev(end())); }
     void pop_front() { erase(begin()); }
-    void insert(const_iterator pos, const T& value) { insert_before_with_value(pos, value); }
+    void insert(const_iterator pos, const T& value) { emplace(pos, value); }
+    void insert(const_iterator pos, T&& value) { emplace(pos, std::move(value)); }
 
-    size_t size() const { return sz; }
-    bool empty() const { return sz == 0; }
+    // All nodes are built first, so if a copy throws the list is left unchanged.
+    template <typename InputIterator, typename = std::enable_if_t<!std::is_integral<InputIterator>::value>>
+    void insert(const_iterator pos, InputIterator first, InputIterator last) {
+        link_chain(pos.node, build_chain(first, last));
+    }
 
-    ~List() {
+    template <typename InputIterator, typename = std::enable_if_t<!std::is_integral<InputIterator>::value>>
+    void assign(InputIterator first, InputIterator last) {
+        Chain chain = build_chain(first, last);
+        clear();
+        link_chain(&base, chain);
+    }
+
+    void assign(size_t count, const T& value) {
+        Chain chain;
+        try {
+            for (size_t i = 0; i < count; ++i) {
+                append_new_node(chain, value);
+            }
+        } catch(...) {
+            destroy_chain(chain);
+            throw;
+        }
+        clear();
+        link_chain(&base, chain);
+    }
+
+    void clear() {
         while (!empty()) {
             pop_front();
         }
-        std::allocator_traits<NodeAllocator>::deallocate(node_alloc, base_node, 1);
     }
-};
+
+    // The splice family relinks nodes without copying; other must use an equal allocator.
+    void splice(const_iterator pos, List& other) {
+        if (this == &other || other.empty()) return;
+        transfer(pos.node, other.base.next, &other.base);
+        sz += other.sz;
+        other.sz = 0;
+    }
+
+    void splice(const_iterator pos, List&& other) { splice(pos, other); }
+
+    void splice(const_iterator pos, List& other, const_iterator it) {
+        BaseNode* next = it.node->next;
+        if (pos.node == it.node || pos.node == next) return;
+        transfer(pos.node, it.node, next);
+        ++sz;
+        --other.sz;
+    }
+
+    void splice(const_iterator pos, List& other, const_iterator first, const_iterator last) {
+        if (this != &other) {
+            size_t count = static_cast<size_t>(std::distance(first, last));
+            sz += count;
+            other.sz -= count;
+        }
+        transfer(pos.node, first.node, last.node);
+    }
+
+    template <typename Compare>
+    void merge(List& other, Compare compare) {
+        if (this == &other) return;
+        size_t other_size = other.sz;
+        BaseNode* merged = merge_chains(detach_all(), other.detach_all(), compare);
+        attach_all(merged);
+        sz += other_size;
+        other.sz = 0;
+    }
+
+    void merge(List& other) { merge(other, std::less<>()); }
+
+    // Stable bottom-up merge sort that only relinks nodes: runs of 2^i nodes wait in bucket i.
+    template <typename Compare>
+    void sort(Compare compare) {
+        BaseNode* buckets[64] = {};
+        BaseNode* rest = detach_all();
+        while (rest != nullptr) {
+            BaseNode* run = rest;
+            rest = rest->next;
+            run->next = nullptr;
+            size_t i = 0;
+            for (; buckets[i] != nullptr; ++i) {
+                run = merge_chains(buckets[i], run, compare);
+                buckets[i] = nullptr;
+            }
+            buckets[i] = run;
+        }
+        BaseNode* sorted = nullptr;
+        for (BaseNode* bucket : buckets) {
+            if (bucket != nullptr) sorted = merge_chains(bucket, sorted, compare);
+        }
+        attach_all(sorted);
+    }
+
+    void sort() { sort(std::less<>()); }
+
+    void reverse() {
+        BaseNode* node = &base;
+        do {
+            std::swap(node->prev, node->next);
+            node = node->prev;
+        } while (node != &base);
+    }
+
+    template <typename BinaryPredicate>
+    size_t unique(BinaryPredicate predicate) {
+        size_t removed = 0;
+        if (sz < 2) return removed;
+        const_iterator previous = begin();
+        const_iterator current = std::next(previous);
+        while (current != end()) {
+            if (predicate(*previous, *current)) {
+                erase(current++);
+                ++removed;
+            } else {
+                previous = current++;
+            }
+        }
+        return removed;
+    }
+
+    size_t unique() { return unique(std::equal_to<>()); }
+
+    size_t size() const { return sz; }
+    bool empty() const { return sz == 0; }
+
+    ~List() {
+        clear();
+    }
+};
+
+    /*              UnrolledList                */
+
+
+// List storing up to node_capacity elements per node, with the node sized to NodeBytes (two
+// cache lines by default), so traversal touches one node per several elements instead of one
+// per element. Inserting into a full node splits it in half; a node that drops below half full
+// on erase borrows from a neighbour or merges with it, and a node is freed once it empties.
+template<typename T, typename Allocator = std::allocator<T>, size_t NodeBytes = 128>
+class UnrolledList {
+private:
+    struct BaseNode {
+        BaseNode* prev;
+        BaseNode* next;
+        size_t count;
+    };
+
+    static_assert(NodeBytes >= sizeof(BaseNode) + sizeof(T), "NodeBytes must fit the node header and at least one element");
+
+    static constexpr size_t node_capacity = (NodeBytes - sizeof(BaseNode)) / sizeof(T);
+
+    struct Node : BaseNode {
+        alignas(T) unsigned char storage[node_capacity * sizeof(T)];
+
+        Node(BaseNode* prev, BaseNode* next): BaseNode{prev, next, 0} {}
+    };
+
+    using NodeAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<Node>;
+    using Traits = std::allocator_traits<Allocator>;
+
+    BaseNode base{&base, &base, 0};
+    NodeAllocator node_alloc;
+    Allocator alloc;
+    size_t sz = 0;
+
+    static T* slot(BaseNode* node, size_t index) {
+        return reinterpret_cast<T*>(static_cast<Node*>(node)->storage) + index;
+    }
+
+    Node* create_node(BaseNode* prev, BaseNode* next) {
+        Node* new_node = std::allocator_traits<NodeAllocator>::allocate(node_alloc, 1);
+        std::allocator_traits<NodeAllocator>::construct(node_alloc, new_node, prev, next);
+        prev->next = new_node;
+        next->prev = new_node;
+        return new_node;
+    }
+
+    void destroy_node(BaseNode* node) {
+        node->prev->next = node->next;
+        node->next->prev = node->prev;
+        Node* value_node = static_cast<Node*>(node);
+        std::allocator_traits<NodeAllocator>::destroy(node_alloc, value_node);
+        std::allocator_traits<NodeAllocator>::deallocate(node_alloc, value_node, 1);
+    }
+
+    // Moves the upper half of a full node into a new node right after it.
+    void split_node(BaseNode* node) {
+        BaseNode* new_node = create_node(node, node->next);
+        size_t half = node->count / 2;
+        for (size_t i = half; i < node->count; ++i) {
+            Traits::construct(alloc, slot(new_node, i - half), std::move_if_noexcept(*slot(node, i)));
+            ++new_node->count;
+        }
+        for (size_t i = half; i < node->count; ++i) {
+            Traits::destroy(alloc, slot(node, i));
+        }
+        node->count = half;
+    }
+
+    // Moves the first count elements of source to the back of target.
+    void transfer_front(BaseNode* source, BaseNode* target, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            Traits::construct(alloc, slot(target, target->count), std::move_if_noexcept(*slot(source, i)));
+            ++target->count;
+        }
+        for (size_t i = count; i < source->count; ++i) {
+            *slot(source, i - count) = std::move(*slot(source, i));
+        }
+        for (size_t i = source->count - count; i < source->count; ++i) {
+            Traits::destroy(alloc, slot(source, i));
+        }
+        source->count -= count;
+    }
+
+    // Moves the last count elements of source to the front of target.
+    void transfer_back(BaseNode* source, BaseNode* target, size_t count) {
+        for (size_t i = target->count; i-- > 0;) {
+            Traits::construct(alloc, slot(target, i + count), std::move_if_noexcept(*slot(target, i)));
+            Traits::destroy(alloc, slot(target, i));
+        }
+        size_t first = source->count - count;
+        for (size_t i = 0; i < count; ++i) {
+            Traits::construct(alloc, slot(target, i), std::move_if_noexcept(*slot(source, first + i)));
+            Traits::destroy(alloc, slot(source, first + i));
+        }
+        target->count += count;
+        source->count = first;
+    }
+
+    // Merges two adjacent nodes into left if the elements fit, otherwise evens out their counts.
+    // Returns the node and index where the element at offset in the concatenation of the two
+    // nodes ended up.
+    std::pair<BaseNode*, size_t> rebalance(BaseNode* left, BaseNode* right, size_t offset) {
+        if (left->count + right->count <= node_capacity) {
+            transfer_front(right, left, right->count);
+            destroy_node(right);
+            return (offset < left->count ? std::make_pair(left, offset) : std::make_pair(left->next, size_t(0)));
+        }
+        if (left->count < right->count)
+            transfer_front(right, left, (right->count - left->count) / 2);
+        else
+            transfer_back(left, right, (left->count - right->count) / 2);
+
+        if (offset < left->count) return {left, offset};
+        offset -= left->count;
+        return (offset < right->count ? std::make_pair(right, offset) : std::make_pair(right->next, size_t(0)));
+    }
+
+    void steal_nodes(UnrolledList& other) {
+        if (other.sz == 0) return;
+        base.next = other.base.next;
+        base.prev = other.base.prev;
+        base.next->prev = &base;
+        base.prev->next = &base;
+        sz = other.sz;
+        other.base.next = other.base.prev = &other.base;
+        other.sz = 0;
+    }
+
+
+    /*              Iterators                */
+
+
+    template<bool Const>
+    class common_iterator {
+    private:
+        BaseNode* node;
+        size_t index;
+    public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = typename std::conditional_t<Const, const T*, T*>;
+        using reference = typename std::conditional_t<Const, const T&, T&>;
+
+        common_iterator(const BaseNode* node, size_t index): node(const_cast<BaseNode*>(node)), index(index) {};
+        common_iterator(): node(nullptr), index(0) {};
+        common_iterator(const common_iterator<false>& iter): node(iter.node), index(iter.index) {};
+
+        typename common_iterator::reference operator*() const { return *slot(node, index); }
+        typename common_iterator::pointer operator->() const { return slot(node, index); }
+
+        bool operator==(const common_iterator& other_iter) const {
+            return node == other_iter.node && index == other_iter.index;
+        }
+
+        bool operator!=(const common_iterator& other) const { return !(*this == other); }
+
+        common_iterator& operator++() {
+            if (++index >= node->count) {
+                node = node->next;
+                index = 0;
+            }
+            return *this;
+        }
+        common_iterator operator++(int) {
+            common_iterator result = *this;
+            ++(*this);
+            return result;
+        }
+
+        common_iterator& operator--() {
+            if (index == 0) {
+                node = node->prev;
+                index = node->count;
+            }
+            --index;
+            return *this;
+        }
+
+        common_iterator operator--(int) {
+            common_iterator result = *this;
+            --(*this);
+            return result;
+        }
+
+        friend class UnrolledList<T, Allocator, NodeBytes>;
+    };
+
+public:
+    using iterator = common_iterator<false>;
+    using const_iterator = common_iterator<true>;
+    using reverse_iterator = std::reverse_iterator<iterator>;
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+    iterator begin() { return iterator(base.next, 0); }
+    const_iterator begin() const { return const_iterator(base.next, 0); }
+    const_iterator cbegin() const { return const_iterator(base.next, 0); }
+    reverse_iterator rbegin() { return std::reverse_iterator(end()); }
+    const_reverse_iterator rbegin() const { return std::reverse_iterator(cend()); }
+    const_reverse_iterator crbegin() const { return std::reverse_iterator(cend());}
+
+    iterator end() { return iterator(&base, 0); }
+    const_iterator end() const { return const_iterator(&base, 0); }
+    const_iterator cend() const { return const_iterator(&base, 0); }
+    reverse_iterator rend() { return std::reverse_iterator(begin()); }
+    const_reverse_iterator rend() const { return std::reverse_iterator(cbegin()); }
+    const_reverse_iterator crend() const { return std::reverse_iterator(cbegin()); }
+
+
+    /*              UnrolledList Methods                */
+
+
+    UnrolledList(): node_alloc(Allocator()), alloc(Allocator()) {}
+
+    explicit UnrolledList(const Allocator& allocator): node_alloc(allocator), alloc(allocator) {}
+
+    UnrolledList(const UnrolledList& other_list):
+            UnrolledList(std::allocator_traits<Allocator>::select_on_container_copy_construction(other_list.alloc)) {
+        try {
+            for (const auto& value : other_list) {
+                push_back(value);
+            }
+        } catch(...) {
+            clear();
+            throw;
+        }
+    }
+
+    UnrolledList(UnrolledList&& other_list) noexcept: node_alloc(std::move(other_list.node_alloc)), alloc(std::move(other_list.alloc)) {
+        steal_nodes(other_list);
+    }
+
+    UnrolledList& operator=(const UnrolledList& other_list) {
+        if (this == &other_list) return *this;
+        constexpr bool propagate = std::allocator_traits<Allocator>::propagate_on_container_copy_assignment::value;
+        UnrolledList copy(propagate ? other_list.alloc : alloc);
+        for (const auto& value : other_list) {
+            copy.push_back(value);
+        }
+        clear();
+        if constexpr (propagate) {
+            node_alloc = other_list.node_alloc;
+            alloc = other_list.alloc;
+        }
+        steal_nodes(copy);
+        return *this;
+    }
+
+    UnrolledList& operator=(UnrolledList&& other_list) noexcept(std::allocator_traits<Allocator>::propagate_on_container_move_assignment::value
+                                                                || std::allocator_traits<Allocator>::is_always_equal::value) {
+        if (this == &other_list) return *this;
+        clear();
+        if constexpr (std::allocator_traits<Allocator>::propagate_on_container_move_assignment::value) {
+            node_alloc = std::move(other_list.node_alloc);
+            alloc = std::move(other_list.alloc);
+            steal_nodes(other_list);
+        } else {
+            if (alloc == other_list.alloc) {
+                steal_nodes(other_list);
+            } else {
+                for (auto& value : other_list) {
+                    push_back(std::move(value));
+                }
+                other_list.clear();
+            }
+        }
+        return *this;
+    }
+
+    NodeAllocator get_allocator() const { return node_alloc; }
+
+    template <typename... Args>
+    iterator emplace(const_iterator pos, Args&&... args) {
+        BaseNode* node = pos.node;
+        size_t index = pos.index;
+        if (index == 0 && node->prev != &base && node->prev->count < node_capacity) {
+            node = node->prev;
+            index = node->count;
+        } else if (node == &base) {
+            node = create_node(base.prev, &base);
+        } else if (node->count == node_capacity) {
+            split_node(node);
+            if (index > node->count) {
+                index -= node->count;
+                node = node->next;
+            }
+        }
+
+        if (index == node->count) {
+            Traits::construct(alloc, slot(node, index), std::forward<Args>(args)...);
+        } else {
+            T value(std::forward<Args>(args)...);
+            Traits::construct(alloc, slot(node, node->count), std::move_if_noexcept(*slot(node, node->count - 1)));
+            std::move_backward(slot(node, index), slot(node, node->count - 1), slot(node, node->count));
+            *slot(node, index) = std::move(value);
+        }
+        ++node->count;
+        ++sz;
+        return iterator(node, index);
+    }
+
+    template <typename... Args>
+    T& emplace_back(Args&&... args) { return *emplace(end(), std::forward<Args>(args)...); }
+
+    template <typename... Args>
+    T& emplace_front(Args&&... args) { return *emplace(begin(), std::forward<Args>(args)...); }
+
+    iterator erase(const_iterator pos) {
+        BaseNode* node = pos.node;
+        std::move(slot(node, pos.index + 1), slot(node, node->count), slot(node, pos.index));
+        Traits::destroy(alloc, slot(node, node->count - 1));
+        --node->count;
+        --sz;
+        if (node->count == 0) {
+            BaseNode* next = node->next;
+            destroy_node(node);
+            return iterator(next, 0);
+        }
+        if (node->count < node_capacity / 2 && (node->next != &base || node->prev != &base)) {
+            auto [next_node, next_index] = (node->next != &base ? rebalance(node, node->next, pos.index)
+                                                                : rebalance(node->prev, node, node->prev->count + pos.index));
+            return iterator(next_node, next_index);
+        }
+        if (pos.index == node->count) return iterator(node->next, 0);
+        return iterator(node, pos.index);
+    }
+
+    void push_back(const T& value) { emplace(end(), value); }
+    void push_back(T&& value) { emplace(end(), std::move(value)); }
+    void push_front(const T& value) { emplace(begin(), value); }
+    void push_front(T&& value) { emplace(begin(), std::move(value)); }
+    void pop_back() { erase(std::prev(end())); }
+    void pop_front() { erase(begin()); }
+    iterator insert(const_iterator pos, const T& value) { return emplace(pos, value); }
+    iterator insert(const_iterator pos, T&& value) { return emplace(pos, std::move(value)); }
+
+    void clear() {
+        while (base.next != &base) {
+            BaseNode* node = base.next;
+            for (size_t i = 0; i < node->count; ++i) {
+                Traits::destroy(alloc, slot(node, i));
+            }
+            destroy_node(node);
+        }
+        sz = 0;
+    }
+
+    size_t size() const { return sz; }
+    bool empty() const { return sz == 0; }
+
+    ~UnrolledList() {
+        clear();
+    }
+};
+
+
+    /*              IntrusiveList                */
+
+
+// Links stored in the element itself: T derives from IntrusiveListHook<Tag> (one base per list
+// an object can be on), and IntrusiveList<T, Tag> links existing objects without allocating or
+// copying. The list does not own its elements; destroying it just unlinks them.
+template <typename Tag = void>
+struct IntrusiveListHook {
+    IntrusiveListHook* prev = nullptr;
+    IntrusiveListHook* next = nullptr;
+
+    IntrusiveListHook() = default;
+    IntrusiveListHook(const IntrusiveListHook&) {}
+    IntrusiveListHook& operator=(const IntrusiveListHook&) { return *this; }
+
+    bool is_linked() const { return next != nullptr; }
+};
+
+template <typename T, typename Tag = void>
+class IntrusiveList {
+private:
+    using Hook = IntrusiveListHook<Tag>;
+
+    Hook base;
+    size_t sz = 0;
+
+    void connect_nodes(Hook* left, Hook* right) {
+        left->next = right;
+        right->prev = left;
+    }
+
+    void reset_base() {
+        base.prev = &base;
+        base.next = &base;
+    }
+
+
+    /*              Iterators                */
+
+
+    template<bool Const>
+    class common_iterator {
+    private:
+        Hook* node;
+    public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = typename std::conditional_t<Const, const T*, T*>;
+        using reference = typename std::conditional_t<Const, const T&, T&>;
+
+        explicit common_iterator(const Hook* node): node(const_cast<Hook*>(node)) {};
+        common_iterator(): node(nullptr) {};
+        common_iterator(const common_iterator<false>& iter): node(iter.node) {};
+
+        typename common_iterator::reference operator*() const { return static_cast<T&>(*node); }
+        typename common_iterator::pointer operator->() const { return static_cast<T*>(node); }
+
+        bool operator==(const common_iterator& other_iter) const { return node == other_iter.node; }
+        bool operator!=(const common_iterator& other) const { return !(*this == other); }
+
+        common_iterator& operator++() {
+            node = node->next;
+            return *this;
+        }
+        common_iterator operator++(int) {
+            common_iterator result = *this;
+            ++(*this);
+            return result;
+        }
+
+        common_iterator& operator--() {
+            node = node->prev;
+            return *this;
+        }
+
+        common_iterator operator--(int) {
+            common_iterator result = *this;
+            --(*this);
+            return result;
+        }
+
+        friend class IntrusiveList<T, Tag>;
+    };
+
+public:
+    using iterator = common_iterator<false>;
+    using const_iterator = common_iterator<true>;
+    using reverse_iterator = std::reverse_iterator<iterator>;
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+    iterator begin() { return iterator(base.next); }
+    const_iterator begin() const { return const_iterator(base.next); }
+    const_iterator cbegin() const { return const_iterator(base.next); }
+    reverse_iterator rbegin() { return std::reverse_iterator(end()); }
+    const_reverse_iterator rbegin() const { return std::reverse_iterator(cend()); }
+    const_reverse_iterator crbegin() const { return std::reverse_iterator(cend());}
+
+    iterator end() { return iterator(&base); }
+    const_iterator end() const { return const_iterator(&base); }
+    const_iterator cend() const { return const_iterator(&base); }
+    reverse_iterator rend() { return std::reverse_iterator(begin()); }
+    const_reverse_iterator rend() const { return std::reverse_iterator(cbegin()); }
+    const_reverse_iterator crend() const { return std::reverse_iterator(cbegin()); }
+
+
+    /*              IntrusiveList Methods                */
+
+
+    IntrusiveList() { reset_base(); }
+    IntrusiveList(const IntrusiveList&) = delete;
+    IntrusiveList& operator=(const IntrusiveList&) = delete;
+
+    IntrusiveList(IntrusiveList&& other_list) noexcept {
+        reset_base();
+        swap(other_list);
+    }
+
+    IntrusiveList& operator=(IntrusiveList&& other_list) noexcept {
+        if (this != &other_list) {
+            clear();
+            swap(other_list);
+        }
+        return *this;
+    }
+
+    void swap(IntrusiveList& other_list) {
+        Hook* first = (sz == 0 ? nullptr : base.next);
+        Hook* last = (sz == 0 ? nullptr : base.prev);
+        if (other_list.sz == 0) {
+            reset_base();
+        } else {
+            connect_nodes(&base, other_list.base.next);
+            connect_nodes(other_list.base.prev, &base);
+        }
+        if (first == nullptr) {
+            other_list.reset_base();
+        } else {
+            connect_nodes(&other_list.base, first);
+            connect_nodes(last, &other_list.base);
+        }
+        std::swap(sz, other_list.sz);
+    }
+
+    // value must not be linked into a list with the same Tag.
+    iterator insert(const_iterator pos, T& value) {
+        Hook* node = &static_cast<Hook&>(value);
+        connect_nodes(pos.node->prev, node);
+        connect_nodes(node, pos.node);
+        ++sz;
+        return iterator(node);
+    }
+
+    iterator erase(const_iterator pos) {
+        Hook* next = pos.node->next;
+        connect_nodes(pos.node->prev, next);
+        pos.node->prev = pos.node->next = nullptr;
+        --sz;
+        return iterator(next);
+    }
+
+    // value must be linked into this list.
+    void erase(T& value) { erase(iterator_to(value)); }
+
+    iterator iterator_to(T& value) { return iterator(&static_cast<Hook&>(value)); }
+    const_iterator iterator_to(const T& value) const { return const_iterator(&static_cast<const Hook&>(value)); }
+
+    void push_back(T& value) { insert(end(), value); }
+    void push_front(T& value) { insert(begin(), value); }
+    void pop_back() { erase(std::prev(end())); }
+    void pop_front() { erase(begin()); }
+
+    T& front() { return *begin(); }
+    T& back() { return *std::prev(end()); }
+
+    void clear() {
+        while (!empty()) {
+            pop_front();
+        }
+    }
+
+    size_t size() const { return sz; }
+    bool empty() const { return sz == 0; }
+
+    ~IntrusiveList() {
+        clear();
+    }
+};
+
+    /*              ConcurrentList                */
+
+
+// Lock-free ordered set after Harris and Michael: a node is logically deleted by setting the low
+// bit of its next pointer and then physically unlinked by whichever thread gets there first.
+// Unlinked nodes are retired to epoch-based reclamation and handed back to the allocator once
+// no thread can still reach them, so the allocator must be thread-safe (std::allocator or
+// ConcurrentStackAllocator, for instance). Each thread announces its epoch in its own slot of a
+// ThreadSlots table, so any number of threads may use one list.
+template <typename T, typename Compare = std::less<T>, typename Allocator = std::allocator<T>>
+class ConcurrentList {
+private:
+    static constexpr size_t cache_line = 64;
+    static constexpr size_t reclaim_period = 32;
+
+    struct BaseNode {
+        std::atomic<uintptr_t> next{0};
+    };
+
+    struct Node : BaseNode {
+        T value;
+        Node* retired_next = nullptr;
+
+        explicit Node(const T& value): value(value) {}
+    };
+
+    struct alignas(cache_line) EpochSlot {
+        std::atomic<bool> active{false};
+        std::atomic<uint64_t> epoch{0};
+        size_t depth = 0;
+    };
+
+    using NodeAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<Node>;
+
+    BaseNode head;
+    NodeAllocator node_alloc;
+    Compare compare;
+    std::atomic<size_t> sz{0};
+
+    alignas(cache_line) std::atomic<uint64_t> global_epoch{0};
+    std::atomic<size_t> retire_count{0};
+    std::atomic<Node*> limbo[3] = {};
+    ThreadSlots<EpochSlot> slots;
+
+    static Node* pointer_of(uintptr_t link) { return reinterpret_cast<Node*>(link & ~uintptr_t(1)); }
+    static bool is_marked(uintptr_t link) { return (link & 1) != 0; }
+    static uintptr_t link_of(Node* node) { return reinterpret_cast<uintptr_t>(node); }
+
+    // Pins the current global epoch in the calling thread's slot for the duration of one
+    // operation; nested guards on the same list keep the outer pin.
+    class EpochGuard {
+    private:
+        EpochSlot& slot;
+    public:
+        explicit EpochGuard(ConcurrentList& list): slot(list.slots.local()) {
+            if (slot.depth++ != 0) return;
+            slot.active.store(true, std::memory_order_seq_cst);
+            slot.epoch.store(list.global_epoch.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+        }
+
+        EpochGuard(const EpochGuard&) = delete;
+        EpochGuard& operator=(const EpochGuard&) = delete;
+
+        ~EpochGuard() {
+            if (--slot.depth == 0) slot.active.store(false, std::memory_order_release);
+        }
+    };
+
+    Node* create_node(const T& value) {
+        Node* new_node = std::allocator_traits<NodeAllocator>::allocate(node_alloc, 1);
+        try {
+            std::allocator_traits<NodeAllocator>::construct(node_alloc, new_node, value);
+        } catch(...) {
+            std::allocator_traits<NodeAllocator>::deallocate(node_alloc, new_node, 1);
+            throw;
+        }
+        return new_node;
+    }
+
+    void destroy_node(Node* node) {
+        std::allocator_traits<NodeAllocator>::destroy(node_alloc, node);
+        std::allocator_traits<NodeAllocator>::deallocate(node_alloc, node, 1);
+    }
+
+    void destroy_chain(Node* node) {
+        while (node != nullptr) {
+            Node* next = node->retired_next;
+            destroy_node(node);
+            node = next;
+        }
+    }
+
+    // A node is filed under the global epoch e read after it was unlinked and freed when the
+    // global epoch reaches e + 2. Threads active at the unlink were pinned at e - 1 or later,
+    // and reaching e + 2 requires all of them to have left.
+    void retire(Node* node) {
+        std::atomic<Node*>& bucket = limbo[global_epoch.load(std::memory_order_seq_cst) % 3];
+        node->retired_next = bucket.load(std::memory_order_relaxed);
+        while (!bucket.compare_exchange_weak(node->retired_next, node, std::memory_order_release, std::memory_order_relaxed)) {}
+
+        if (retire_count.fetch_add(1, std::memory_order_relaxed) % reclaim_period == 0)
+            try_advance_epoch();
+    }
+
+    void try_advance_epoch() {
+        uint64_t epoch = global_epoch.load(std::memory_order_seq_cst);
+        bool lagging = false;
+        slots.for_each([epoch, &lagging](EpochSlot& slot) {
+            if (slot.active.load(std::memory_order_seq_cst) && slot.epoch.load(std::memory_order_seq_cst) != epoch)
+                lagging = true;
+        });
+        if (lagging) return;
+        if (global_epoch.compare_exchange_strong(epoch, epoch + 1, std::memory_order_seq_cst))
+            destroy_chain(limbo[(epoch + 2) % 3].exchange(nullptr, std::memory_order_acquire));
+    }
+
+    // Returns the first node not less than value and the link pointing at it, unlinking and
+    // retiring marked nodes on the way.
+    std::pair<BaseNode*, Node*> search(const T& value, const EpochGuard&) {
+        while (true) {
+            BaseNode* prev = &head;
+            uintptr_t current = prev->next.load(std::memory_order_acquire);
+            bool restart = false;
+            while (!restart) {
+                Node* node = pointer_of(current);
+                if (node == nullptr) return {prev, nullptr};
+                uintptr_t next = node->next.load(std::memory_order_acquire);
+                if (is_marked(next)) {
+                    uintptr_t expected = current;
+                    if (prev->next.compare_exchange_strong(expected, next & ~uintptr_t(1), std::memory_order_acq_rel)) {
+                        retire(node);
+                        current = next & ~uintptr_t(1);
+                    } else {
+                        restart = true;
+                    }
+                    continue;
+                }
+                if (!compare(node->value, value)) return {prev, node};
+                prev = node;
+                current = next;
+            }
+        }
+    }
+
+    bool equivalent(const T& first, const T& second) const { return !compare(first, second) && !compare(second, first); }
+
+public:
+    ConcurrentList() = default;
+    explicit ConcurrentList(const Allocator& allocator, const Compare& given_compare = Compare()):
+            node_alloc(allocator), compare(given_compare) {}
+
+    ConcurrentList(const ConcurrentList&) = delete;
+    ConcurrentList& operator=(const ConcurrentList&) = delete;
+
+    // Must not run concurrently with any other operation.
+    ~ConcurrentList() {
+        Node* node = pointer_of(head.next.load(std::memory_order_relaxed));
+        while (node != nullptr) {
+            Node* next = pointer_of(node->next.load(std::memory_order_relaxed));
+            destroy_node(node);
+            node = next;
+        }
+        for (auto& bucket : limbo) {
+            destroy_chain(bucket.load(std::memory_order_relaxed));
+        }
+    }
+
+    bool insert(const T& value) {
+        Node* new_node = create_node(value);
+        EpochGuard guard(*this);
+        while (true) {
+            auto [prev, node] = search(value, guard);
+            if (node != nullptr && equivalent(node->value, value)) {
+                destroy_node(new_node);
+                return false;
+            }
+            uintptr_t expected = link_of(node);
+            new_node->next.store(expected, std::memory_order_relaxed);
+            if (prev->next.compare_exchange_strong(expected, link_of(new_node), std::memory_order_release, std::memory_order_relaxed)) {
+                sz.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+    }
+
+    bool erase(const T& value) {
+        EpochGuard guard(*this);
+        while (true) {
+            auto [prev, node] = search(value, guard);
+            if (node == nullptr || !equivalent(node->value, value)) return false;
+
+            uintptr_t next = node->next.load(std::memory_order_acquire);
+            if (is_marked(next)) continue;
+            if (!node->next.compare_exchange_strong(next, next | 1, std::memory_order_acq_rel)) continue;
+
+            sz.fetch_sub(1, std::memory_order_relaxed);
+            uintptr_t expected = link_of(node);
+            if (prev->next.compare_exchange_strong(expected, next, std::memory_order_acq_rel))
+                retire(node);
+            else
+                search(value, guard);
+            return true;
+        }
+    }
+
+    bool contains(const T& value) {
+        EpochGuard guard(*this);
+        Node* node = pointer_of(head.next.load(std::memory_order_acquire));
+        while (node != nullptr && compare(node->value, value)) {
+            node = pointer_of(node->next.load(std::memory_order_acquire));
+        }
+        return node != nullptr && equivalent(node->value, value) && !is_marked(node->next.load(std::memory_order_acquire));
+    }
+
+    // Exact when no operation is in flight.
+    size_t size() const { return sz.load(std::memory_order_relaxed); }
+    bool empty() const { return size() == 0; }
+};
+
+template <typename T>
+using PmrList = List<T, std::pmr::polymorphic_allocator<T>>;
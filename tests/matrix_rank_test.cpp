@@ -0,0 +1,41 @@
+// g++ -std=c++17 -I.. matrix_rank_test.cpp -o matrix_rank_test && ./matrix_rank_test
+#include "../Matrix.h"
+#include <cassert>
+
+int main() {
+    // Pivot-free columns must not stop elimination: {{0, 1}, {0, 0}} has rank 1.
+    Matrix<2, 2, double> nilpotent;
+    nilpotent[0][1] = 1;
+    assert(nilpotent.rank() == 1);
+    assert(nilpotent.lu().rank() == 1);
+    assert(nilpotent.lu().det() == 0.0);
+
+    // The 3x3 shift matrix has rank 2.
+    Matrix<3, 3, double> shift;
+    shift[0][1] = 1;
+    shift[1][2] = 1;
+    assert(shift.rank() == 2);
+    assert(shift.lu().det() == 0.0);
+
+    bool thrown = false;
+    try {
+        shift.lu().inverse();
+    } catch (const std::domain_error &) {
+        thrown = true;
+    }
+    assert(thrown);
+
+    Matrix<3, 3, double> singular{{1, 2, 3}, {4, 5, 6}, {7, 8, 9}};
+    assert(singular.rank() == 2);
+
+    Matrix<3, 3, double> regular{{2, 1, 0}, {1, 3, 1}, {0, 1, 4}};
+    assert(regular.rank() == 3);
+    assert(std::abs(regular.det() - 18) < 1e-12);
+
+    Matrix<3, 3> exact_shift;
+    exact_shift[0][1] = 1;
+    exact_shift[1][2] = 1;
+    assert(exact_shift.rank() == 2);
+
+    std::cout << "ok\n";
+}